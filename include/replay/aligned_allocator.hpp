@@ -1,9 +1,19 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+
 namespace replay
 {
 
-template <typename T> class aligned_allocator
+/** Allocator that aligns storage to at least Alignment bytes, e.g. to a cache line for SIMD access.
+ */
+template <typename T, std::size_t Alignment = alignof(T)> class aligned_allocator
 {
 public:
     using pointer = T*;
@@ -12,11 +22,17 @@ public:
     pointer allocate(size_type n);
     void deallocate(pointer p, size_type n);
 
+    /** Resize an allocation in place if possible, keeping the first min(old_n, new_n) elements.
+        Only available for trivially copyable types. On failure, throws and leaves the old allocation intact.
+    */
+    pointer reallocate(pointer p, size_type old_n, size_type new_n);
+
 }; // class aligned_allocatortemplate <typename T>
 
-template <typename T> typename aligned_allocator<T>::pointer aligned_allocator<T>::allocate(size_type n)
+template <typename T, std::size_t Alignment>
+typename aligned_allocator<T, Alignment>::pointer aligned_allocator<T, Alignment>::allocate(size_type n)
 {
-    size_type const alignment = std::max(alignof(ptrdiff_t), alignof(T));
+    size_type const alignment = std::max({ alignof(ptrdiff_t), alignof(T), Alignment });
     size_type const object_size = sizeof(ptrdiff_t) + sizeof(T) * n;
     size_type const buffer_size = object_size + alignment;
 
@@ -37,7 +53,7 @@ template <typename T> typename aligned_allocator<T>::pointer aligned_allocator<T
     return reinterpret_cast<pointer>(body);
 } // aligned_allocator<T>::allocate 
 
-template <typename T> void aligned_allocator<T>::deallocate(pointer p, size_type)
+template <typename T, std::size_t Alignment> void aligned_allocator<T, Alignment>::deallocate(pointer p, size_type)
 {
     char const* header = reinterpret_cast<char*>(p) - sizeof(ptrdiff_t);
     auto offset = *reinterpret_cast<ptrdiff_t const*>(header);
@@ -45,4 +61,45 @@ template <typename T> void aligned_allocator<T>::deallocate(pointer p, size_type
     std::free(block);
 } // aligned_allocator<T>::deallocate
 
+template <typename T, std::size_t Alignment>
+typename aligned_allocator<T, Alignment>::pointer
+aligned_allocator<T, Alignment>::reallocate(pointer p, size_type old_n, size_type new_n)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Can only reallocate trivially copyable types");
+
+    if (p == nullptr)
+    {
+        return allocate(new_n);
+    }
+
+    char* const old_body = reinterpret_cast<char*>(p);
+    auto const old_offset = *reinterpret_cast<ptrdiff_t const*>(old_body - sizeof(ptrdiff_t));
+
+    size_type const alignment = std::max({ alignof(ptrdiff_t), alignof(T), Alignment });
+    size_type const object_size = sizeof(ptrdiff_t) + sizeof(T) * new_n;
+    size_type const buffer_size = object_size + alignment;
+
+    auto const block = reinterpret_cast<char*>(std::realloc(old_body - old_offset, buffer_size));
+    if (block == nullptr)
+    {
+        throw std::bad_alloc{};
+    }
+
+    void* storage = (block) + sizeof(ptrdiff_t);
+    size_t shift = buffer_size;
+
+    char* const body = reinterpret_cast<char*>(std::align(alignment, object_size, storage, shift));
+    char* const offset = body - sizeof(ptrdiff_t);
+
+    // The new block might have a different alignment, so the contents might have to be shifted
+    if (body - block != old_offset)
+    {
+        std::memmove(body, block + old_offset, sizeof(T) * std::min(old_n, new_n));
+    }
+
+    *reinterpret_cast<ptrdiff_t*>(offset) = body - block;
+
+    return reinterpret_cast<pointer>(body);
+} // aligned_allocator<T>::reallocate
+
 } // namespace replay
\ No newline at end of file
@@ -0,0 +1,281 @@
+/*
+replay
+Software Library
+
+Copyright (c) 2010-2019 Marius Elvert
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+
+*/
+
+#pragma once
+
+// Coroutine support is only available when compiling as C++20 or newer
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <coroutine>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+namespace replay
+{
+
+/** Multi-producer, multi-consumer queue for coroutines.
+    co_await on \ref pop suspends the calling coroutine until a value is available, and co_await on \ref push
+    suspends it while the queue is at its maximum size. Suspended coroutines do not block a thread. They are handed
+    to the executor to be resumed once they can make progress.
+    \note The queue must outlive all coroutines suspended on it.
+ */
+template <class T> class async_queue
+{
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+
+    /** Called with the handle of a coroutine that is ready to be resumed.
+        Typically this posts the handle's resume() to a thread pool or event loop.
+     */
+    using executor_type = std::function<void(std::coroutine_handle<>)>;
+
+    class pop_awaiter
+    {
+    public:
+        explicit pop_awaiter(async_queue& queue)
+        : m_queue(queue)
+        {
+        }
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle)
+        {
+            std::coroutine_handle<> producer;
+            {
+                std::lock_guard<std::mutex> lock(m_queue.m_mutex);
+                if (m_queue.m_values.empty())
+                {
+                    m_handle = handle;
+                    m_queue.m_waiting_consumers.push_back(this);
+                    return true;
+                }
+
+                m_result.emplace(m_queue.take_front(producer));
+            }
+
+            m_queue.schedule(producer);
+            return false;
+        }
+
+        value_type await_resume()
+        {
+            return std::move(*m_result);
+        }
+
+    private:
+        friend class async_queue;
+
+        async_queue& m_queue;
+        std::coroutine_handle<> m_handle;
+        std::optional<value_type> m_result;
+    };
+
+    class push_awaiter
+    {
+    public:
+        push_awaiter(async_queue& queue, value_type value)
+        : m_queue(queue)
+        , m_value(std::move(value))
+        {
+        }
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle)
+        {
+            std::coroutine_handle<> consumer;
+            {
+                std::lock_guard<std::mutex> lock(m_queue.m_mutex);
+                if (!m_queue.offer(m_value, consumer))
+                {
+                    m_handle = handle;
+                    m_queue.m_waiting_producers.push_back(this);
+                    return true;
+                }
+            }
+
+            m_queue.schedule(consumer);
+            return false;
+        }
+
+        void await_resume() noexcept
+        {
+        }
+
+    private:
+        friend class async_queue;
+
+        async_queue& m_queue;
+        value_type m_value;
+        std::coroutine_handle<> m_handle;
+    };
+
+    /** Create a queue that resumes suspended coroutines via the given executor.
+        \param max_size Number of values above which producers are suspended. Must be positive, since consumers
+        only take values that are already in the queue.
+     */
+    explicit async_queue(executor_type executor, size_type max_size = std::numeric_limits<size_type>::max())
+    : m_executor(std::move(executor))
+    , m_max_size(max_size)
+    {
+        if (max_size == 0)
+            throw std::invalid_argument("Queue size limit must be positive");
+    }
+
+    async_queue(async_queue const&) = delete;
+    async_queue& operator=(async_queue const&) = delete;
+
+    /** Awaitable that yields the next value.
+     */
+    pop_awaiter pop()
+    {
+        return pop_awaiter(*this);
+    }
+
+    /** Awaitable that adds a value, suspending while the queue is full.
+     */
+    push_awaiter push(value_type value)
+    {
+        return push_awaiter(*this, std::move(value));
+    }
+
+    /** Add a value from outside a coroutine, without waiting.
+        \returns false if the queue is full. The value is left untouched in that case.
+     */
+    bool try_push(value_type& value)
+    {
+        std::coroutine_handle<> consumer;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!offer(value, consumer))
+                return false;
+        }
+
+        schedule(consumer);
+        return true;
+    }
+
+    /** Add a temporary value from outside a coroutine, without waiting.
+        \returns false if the queue is full.
+     */
+    bool try_push(value_type&& value)
+    {
+        return try_push(value);
+    }
+
+    /** Remove a value from outside a coroutine, without waiting.
+     */
+    std::optional<value_type> try_pop()
+    {
+        std::optional<value_type> result;
+        std::coroutine_handle<> producer;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_values.empty())
+                return result;
+
+            result.emplace(take_front(producer));
+        }
+
+        schedule(producer);
+        return result;
+    }
+
+    /** Number of values waiting to be consumed.
+     */
+    size_type size() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_values.size();
+    }
+
+private:
+    // Needs to be called with the lock held. Hands the value to a waiting consumer or queues it if there is space.
+    bool offer(value_type& value, std::coroutine_handle<>& consumer_to_resume)
+    {
+        if (!m_waiting_consumers.empty())
+        {
+            auto consumer = m_waiting_consumers.front();
+            m_waiting_consumers.pop_front();
+            consumer->m_result.emplace(std::move(value));
+            consumer_to_resume = consumer->m_handle;
+            return true;
+        }
+
+        if (m_values.size() >= m_max_size)
+            return false;
+
+        m_values.push_back(std::move(value));
+        return true;
+    }
+
+    // Needs to be called with the lock held and a non-empty queue. Lets a waiting producer fill the freed space.
+    value_type take_front(std::coroutine_handle<>& producer_to_resume)
+    {
+        value_type result = std::move(m_values.front());
+        m_values.pop_front();
+
+        if (!m_waiting_producers.empty())
+        {
+            auto producer = m_waiting_producers.front();
+            m_waiting_producers.pop_front();
+            m_values.push_back(std::move(producer->m_value));
+            producer_to_resume = producer->m_handle;
+        }
+
+        return result;
+    }
+
+    void schedule(std::coroutine_handle<> handle)
+    {
+        if (handle)
+            m_executor(handle);
+    }
+
+    executor_type m_executor;
+    size_type const m_max_size;
+    mutable std::mutex m_mutex;
+    std::deque<value_type> m_values;
+    std::deque<pop_awaiter*> m_waiting_consumers;
+    std::deque<push_awaiter*> m_waiting_producers;
+};
+
+} // namespace replay
+
+#endif
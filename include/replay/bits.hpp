@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace replay
+{
+
+/** Index of the lowest set bit. The argument must not be zero.
+ */
+inline unsigned int count_trailing_zeros(std::uint64_t value)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return static_cast<unsigned int>(index);
+#else
+    return static_cast<unsigned int>(__builtin_ctzll(value));
+#endif
+}
+
+/** Number of zero bits above the highest set bit. The argument must not be zero.
+ */
+inline unsigned int count_leading_zeros(std::uint64_t value)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return 63u - static_cast<unsigned int>(index);
+#else
+    return static_cast<unsigned int>(__builtin_clzll(value));
+#endif
+}
+
+/** Number of set bits.
+ */
+inline unsigned int popcount(std::uint64_t value)
+{
+#if defined(_MSC_VER)
+    return static_cast<unsigned int>(__popcnt64(value));
+#else
+    return static_cast<unsigned int>(__builtin_popcountll(value));
+#endif
+}
+
+} // namespace replay
@@ -0,0 +1,278 @@
+/*
+replay
+Software Library
+
+Copyright (c) 2010-2019 Marius Elvert
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <replay/table.hpp>
+#include <unordered_map>
+
+namespace replay
+{
+
+/** Coordinate of a chunk in a \ref chunked_grid.
+ */
+struct chunk_coordinate
+{
+    std::int64_t x;
+    std::int64_t y;
+
+    bool operator==(chunk_coordinate const& rhs) const
+    {
+        return x == rhs.x && y == rhs.y;
+    }
+
+    bool operator!=(chunk_coordinate const& rhs) const
+    {
+        return !(*this == rhs);
+    }
+};
+
+/** Hash for \ref chunk_coordinate.
+ */
+struct chunk_coordinate_hash
+{
+    std::size_t operator()(chunk_coordinate const& rhs) const
+    {
+        auto const x = static_cast<std::uint64_t>(rhs.x);
+        auto const y = static_cast<std::uint64_t>(rhs.y);
+        auto const hash = (x * 0x9E3779B97F4A7C15ull) ^ (y + 0x632BE59BD9B4E019ull + (x << 6) + (x >> 2));
+        return static_cast<std::size_t>(hash ^ (hash >> 32));
+    }
+};
+
+/** Unbounded two dimensional grid with signed coordinates, stored as fixed-size \ref table chunks.
+    Chunks are only allocated when an element in them is written, and all other elements read as the background value.
+    Memory therefore scales with the touched area, not with its bounding box.
+    \tparam ChunkSize Width and height of each chunk.
+    \ingroup Container
+*/
+template <class T, std::size_t ChunkSize = 64> class chunked_grid
+{
+public:
+    typedef T value_type;
+    typedef std::int64_t coordinate_type;
+    typedef table<T> chunk_type;
+
+    static constexpr coordinate_type chunk_size = static_cast<coordinate_type>(ChunkSize);
+
+    /** Cached access to elements, to speed up lookups that are close to each other, e.g. neighborhoods.
+        Only the chunk of the last access is remembered, so this is invalidated by adding or removing chunks.
+    */
+    class const_accessor
+    {
+    public:
+        explicit const_accessor(chunked_grid const& grid)
+        : m_grid(grid)
+        , m_chunk(nullptr)
+        , m_coordinate{ 0, 0 }
+        {
+        }
+
+        /** Get an element or the background value.
+         */
+        value_type const& operator()(coordinate_type x, coordinate_type y)
+        {
+            auto const coordinate = chunk_of(x, y);
+            if (m_chunk == nullptr || coordinate != m_coordinate)
+            {
+                m_chunk = m_grid.find_chunk(coordinate);
+                m_coordinate = coordinate;
+            }
+
+            if (m_chunk == nullptr)
+                return m_grid.m_background;
+
+            return (*m_chunk)(local(x, coordinate.x), local(y, coordinate.y));
+        }
+
+    private:
+        chunked_grid const& m_grid;
+        chunk_type const* m_chunk;
+        chunk_coordinate m_coordinate;
+    };
+
+    /** Construct an empty grid.
+        \param background The value of all elements that have not been written.
+    */
+    explicit chunked_grid(value_type const& background = value_type())
+    : m_background(background)
+    {
+    }
+
+    /** Get an element or the background value. Never allocates.
+     */
+    value_type const& get(coordinate_type x, coordinate_type y) const
+    {
+        auto const coordinate = chunk_of(x, y);
+        auto const chunk = find_chunk(coordinate);
+        if (chunk == nullptr)
+            return m_background;
+
+        return (*chunk)(local(x, coordinate.x), local(y, coordinate.y));
+    }
+
+    /** Access an element for writing, allocating its chunk if needed.
+     */
+    value_type& operator()(coordinate_type x, coordinate_type y)
+    {
+        auto const coordinate = chunk_of(x, y);
+        return chunk_at(coordinate)(local(x, coordinate.x), local(y, coordinate.y));
+    }
+
+    /** Set an element. Writing the background value does not allocate a chunk.
+     */
+    void set(coordinate_type x, coordinate_type y, value_type const& value)
+    {
+        auto const coordinate = chunk_of(x, y);
+        auto chunk = find_chunk(coordinate);
+        if (chunk == nullptr)
+        {
+            if (value == m_background)
+                return;
+            chunk = &chunk_at(coordinate);
+        }
+        (*chunk)(local(x, coordinate.x), local(y, coordinate.y)) = value;
+    }
+
+    /** Get the chunk with the given chunk coordinate, or nullptr if it is not allocated.
+     */
+    chunk_type const* find_chunk(chunk_coordinate const& coordinate) const
+    {
+        auto const found = m_chunks.find(coordinate);
+        return found == m_chunks.end() ? nullptr : &found->second;
+    }
+
+    /** Get the chunk with the given chunk coordinate, or nullptr if it is not allocated.
+     */
+    chunk_type* find_chunk(chunk_coordinate const& coordinate)
+    {
+        auto const found = m_chunks.find(coordinate);
+        return found == m_chunks.end() ? nullptr : &found->second;
+    }
+
+    /** Get the chunk with the given chunk coordinate, allocating it and filling it with the background if needed.
+     */
+    chunk_type& chunk_at(chunk_coordinate const& coordinate)
+    {
+        auto found = m_chunks.find(coordinate);
+        if (found == m_chunks.end())
+            found = m_chunks.emplace(coordinate, chunk_type(ChunkSize, ChunkSize, m_background)).first;
+        return found->second;
+    }
+
+    /** Call function(coordinate, chunk) for all allocated chunks, in no particular order.
+        Element (x, y) of a chunk is at grid coordinate (coordinate.x * chunk_size + x, coordinate.y * chunk_size + y).
+    */
+    template <class Function> void for_each_chunk(Function&& function)
+    {
+        for (auto& each : m_chunks)
+            function(each.first, each.second);
+    }
+
+    /** Call function(coordinate, chunk) for all allocated chunks, in no particular order.
+     */
+    template <class Function> void for_each_chunk(Function&& function) const
+    {
+        for (auto const& each : m_chunks)
+            function(each.first, each.second);
+    }
+
+    /** Free all chunks that only contain the background value.
+        \returns The number of chunks freed.
+    */
+    std::size_t evict_empty_chunks()
+    {
+        std::size_t result = 0;
+        for (auto i = m_chunks.begin(); i != m_chunks.end();)
+        {
+            auto const& chunk = i->second;
+            if (std::all_of(chunk.begin(), chunk.end(), [&](value_type const& x) { return x == m_background; }))
+            {
+                i = m_chunks.erase(i);
+                ++result;
+            }
+            else
+            {
+                ++i;
+            }
+        }
+        return result;
+    }
+
+    /** Free a single chunk, resetting its elements to the background.
+     */
+    void erase_chunk(chunk_coordinate const& coordinate)
+    {
+        m_chunks.erase(coordinate);
+    }
+
+    /** Free all chunks.
+     */
+    void clear()
+    {
+        m_chunks.clear();
+    }
+
+    /** Number of allocated chunks.
+     */
+    std::size_t chunk_count() const
+    {
+        return m_chunks.size();
+    }
+
+    value_type const& background() const
+    {
+        return m_background;
+    }
+
+    /** Get the coordinate of the chunk that contains an element.
+     */
+    static chunk_coordinate chunk_of(coordinate_type x, coordinate_type y)
+    {
+        return chunk_coordinate{ floor_divide(x), floor_divide(y) };
+    }
+
+private:
+    /** Division that rounds towards negative infinity, so that chunk -1 covers [-chunk_size, -1].
+     */
+    static coordinate_type floor_divide(coordinate_type value)
+    {
+        return value >= 0 ? value / chunk_size : -((-(value + 1)) / chunk_size) - 1;
+    }
+
+    static std::size_t local(coordinate_type value, coordinate_type chunk)
+    {
+        return static_cast<std::size_t>(value - chunk * chunk_size);
+    }
+
+    std::unordered_map<chunk_coordinate, chunk_type, chunk_coordinate_hash> m_chunks;
+    value_type m_background;
+};
+
+} // namespace replay
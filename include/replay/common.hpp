@@ -27,9 +27,18 @@ Copyright (c) 2010-2019 Marius Elvert
 #ifndef replay_common_hpp
 #define replay_common_hpp
 
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+
 namespace replay
 {
 
+/** Assumed size of a cache line in bytes.
+    Data written by different threads is padded to this size to avoid false sharing.
+*/
+constexpr std::size_t cache_line_size = 64;
+
 /** Tag type to use 'uninitializing constructors'.
     Types that support this will typically expose an explicit unary constructor
     taking an uninitialized_tag and leave all contents uninitialized.
@@ -57,6 +66,27 @@ struct conversion_enabled
 template <class source_type, class target_type> struct convertible_tag
 {
 };
+
+namespace detail
+{
+
+/** Round a queue capacity up to a power of two that is at least minimum, so positions can be wrapped with a mask.
+    Throws std::invalid_argument for zero and std::length_error if the result would not fit into std::size_t.
+*/
+inline std::size_t round_up_to_power_of_two(std::size_t value, std::size_t minimum = 1)
+{
+    if (value == 0)
+        throw std::invalid_argument("Queue capacity must be positive");
+    if (value > (std::size_t(1) << (std::numeric_limits<std::size_t>::digits - 1)))
+        throw std::length_error("Queue capacity is too large");
+
+    auto result = minimum;
+    while (result < value)
+        result *= 2;
+    return result;
+}
+
+} // namespace detail
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <replay/aligned_allocator.hpp>
+#include <replay/mask_scan.hpp>
+#include <stdexcept>
+#include <utility>
+
+namespace replay
+{
+
+/** Variant of \ref index_map that can be filled from several threads at once.
+    The occupancy mask is updated with atomic fetch_or/fetch_and per word and the size is a relaxed atomic counter,
+    so insert, erase and contains may be called concurrently as long as no two threads work on the same key.
+    Keys sharing a mask word are fine. Growing is not thread-safe. Call \ref reserve beforehand, while no other
+    thread is using the map, and keep all keys below \ref capacity.
+*/
+template <class T> class concurrent_index_map
+{
+public:
+    using size_type = std::size_t;
+    using key_type = size_type;
+    using mapped_type = T;
+    using allocator_type = replay::aligned_allocator<mapped_type>;
+    using mask_element_type = std::uint64_t;
+
+    enum
+    {
+        bits_per_mask = sizeof(mask_element_type) * 8 / sizeof(std::uint8_t),
+    };
+
+    concurrent_index_map() = default;
+
+    explicit concurrent_index_map(size_type capacity)
+    {
+        reserve(capacity);
+    }
+
+    concurrent_index_map(concurrent_index_map const&) = delete;
+    concurrent_index_map& operator=(concurrent_index_map const&) = delete;
+
+    concurrent_index_map(concurrent_index_map&& rhs) noexcept
+    : size_(rhs.size_.load(std::memory_order_relaxed))
+    , capacity_(rhs.capacity_)
+    , buffer_(rhs.buffer_)
+    , mask_(std::move(rhs.mask_))
+    {
+        rhs.size_.store(0, std::memory_order_relaxed);
+        rhs.capacity_ = 0;
+        rhs.buffer_ = nullptr;
+    }
+
+    concurrent_index_map& operator=(concurrent_index_map&& rhs) noexcept
+    {
+        if (&rhs == this)
+            return *this;
+
+        clear();
+        if (buffer_ != nullptr)
+            allocator_type().deallocate(buffer_, capacity_);
+
+        size_.store(rhs.size_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        capacity_ = rhs.capacity_;
+        buffer_ = rhs.buffer_;
+        mask_ = std::move(rhs.mask_);
+
+        rhs.size_.store(0, std::memory_order_relaxed);
+        rhs.capacity_ = 0;
+        rhs.buffer_ = nullptr;
+        return *this;
+    }
+
+    ~concurrent_index_map()
+    {
+        clear();
+        if (buffer_ != nullptr)
+            allocator_type().deallocate(buffer_, capacity_);
+    }
+
+    /** Grow the storage so that all keys below the given capacity can be used.
+        \note Not thread-safe. No other thread may access the map during this call.
+     */
+    void reserve(size_type new_capacity)
+    {
+        if (new_capacity <= capacity_)
+            return;
+
+        auto const new_mask_size = detail::mask_word_count(new_capacity);
+        std::unique_ptr<std::atomic<mask_element_type>[]> new_mask(new std::atomic<mask_element_type>[new_mask_size]);
+        for (size_type i = 0; i < new_mask_size; ++i)
+            new_mask[i].store(i < detail::mask_word_count(capacity_) ? mask_[i].load(std::memory_order_relaxed) : 0,
+                              std::memory_order_relaxed);
+
+        auto allocator = allocator_type();
+        auto new_buffer = allocator.allocate(new_capacity);
+        for_each_initialized([&](size_type key) {
+            new (new_buffer + key) mapped_type(std::move(buffer_[key]));
+            buffer_[key].~mapped_type();
+        });
+
+        if (buffer_ != nullptr)
+            allocator.deallocate(buffer_, capacity_);
+
+        buffer_ = new_buffer;
+        mask_ = std::move(new_mask);
+        capacity_ = new_capacity;
+    }
+
+    /** Insert a value if the key is not used yet. Thread-safe for distinct keys.
+        \returns false if the key was already used.
+        \throws std::out_of_range if the key is not below the capacity.
+     */
+    template <class InitializerType> bool insert(key_type key, InitializerType&& value)
+    {
+        check_capacity(key);
+        if (contains(key))
+            return false;
+
+        new (buffer_ + key) mapped_type(std::forward<InitializerType>(value));
+
+        // Publish the element. Release makes the constructed value visible to threads that observe the bit.
+        mask_[key / bits_per_mask].fetch_or(bit_for(key), std::memory_order_release);
+        size_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /** Erase a value. Thread-safe for distinct keys.
+        \returns false if there was no value with this key.
+     */
+    bool erase(key_type key)
+    {
+        if (key >= capacity_)
+            return false;
+
+        auto const previous = mask_[key / bits_per_mask].fetch_and(~bit_for(key), std::memory_order_acq_rel);
+        if (!(previous & bit_for(key)))
+            return false;
+
+        buffer_[key].~mapped_type();
+        size_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /** Check whether a key is used. Thread-safe.
+     */
+    bool contains(key_type key) const
+    {
+        return key < capacity_ && (mask_[key / bits_per_mask].load(std::memory_order_acquire) & bit_for(key));
+    }
+
+    mapped_type& operator[](key_type key)
+    {
+        return buffer_[key];
+    }
+
+    mapped_type const& operator[](key_type key) const
+    {
+        return buffer_[key];
+    }
+
+    mapped_type& at(key_type key)
+    {
+        return const_cast<mapped_type&>(const_cast<concurrent_index_map const&>(*this).at(key));
+    }
+
+    mapped_type const& at(key_type key) const
+    {
+        if (!contains(key))
+            throw std::out_of_range("Element not inserted");
+        return buffer_[key];
+    }
+
+    /** Number of elements. Only a snapshot while other threads are inserting or erasing.
+     */
+    size_type size() const
+    {
+        return size_.load(std::memory_order_relaxed);
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    size_type capacity() const
+    {
+        return capacity_;
+    }
+
+    /** Call function(key, value) for all elements in ascending key order.
+        \note Not thread-safe with concurrent insert or erase.
+     */
+    template <class Function> void for_each(Function&& function)
+    {
+        for_each_initialized([&](size_type key) { function(key, buffer_[key]); });
+    }
+
+    /** Call function(key, value) for all elements in ascending key order.
+        \note Not thread-safe with concurrent insert or erase.
+     */
+    template <class Function> void for_each(Function&& function) const
+    {
+        for_each_initialized([&](size_type key) { function(key, buffer_[key]); });
+    }
+
+    /** Erase all elements, keeping the capacity.
+        \note Not thread-safe.
+     */
+    void clear()
+    {
+        for_each_initialized([this](size_type key) { buffer_[key].~mapped_type(); });
+        for (size_type i = 0; i < detail::mask_word_count(capacity_); ++i)
+            mask_[i].store(0, std::memory_order_relaxed);
+        size_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    static mask_element_type bit_for(key_type key)
+    {
+        return mask_element_type{ 1 } << (key % bits_per_mask);
+    }
+
+    void check_capacity(key_type key) const
+    {
+        if (key >= capacity_)
+            throw std::out_of_range("Key exceeds reserved capacity");
+    }
+
+    template <class Function> void for_each_initialized(Function function) const
+    {
+        detail::for_each_set_bit(mask_.get(), 0, capacity_, function);
+    }
+
+    std::atomic<size_type> size_{ 0 };
+    size_type capacity_ = 0;
+    mapped_type* buffer_ = nullptr;
+    std::unique_ptr<std::atomic<mask_element_type>[]> mask_;
+};
+
+} // namespace replay
@@ -26,49 +26,322 @@ Copyright (c) 2010-2019 Marius Elvert
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <condition_variable>
 #include <deque>
+#include <iterator>
 #include <mutex>
-#include <condition_variable>
 #include <optional>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 namespace replay
 {
+namespace detail
+{
+
+/** Tell the processor that the calling thread is busy-waiting. Does nothing where there is no such hint.
+ */
+inline void cpu_relax()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_pause();
+#elif defined(_MSC_VER) && defined(_M_ARM64)
+    __yield();
+#elif defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+} // namespace detail
+
+/** Waiting policy for \ref concurrent_queue that blocks on a condition variable right away.
+ */
+struct blocking_wait
+{
+    static constexpr std::size_t spin_count = 0;
+    static constexpr std::size_t yield_count = 0;
+};
+
+/** Waiting policy for \ref concurrent_queue that first busy-waits, then yields the thread and only then blocks.
+    This avoids a sleep/wake round-trip through the OS when the other side usually answers within microseconds,
+    at the price of burning some CPU time while waiting.
+ */
+template <std::size_t SpinCount = 256, std::size_t YieldCount = 16> struct spin_then_block_wait
+{
+    static constexpr std::size_t spin_count = SpinCount;
+    static constexpr std::size_t yield_count = YieldCount;
+};
+
+/** Snapshot of the statistics recorded by \ref queue_statistics.
+ */
+struct queue_statistics_snapshot
+{
+    static constexpr std::size_t histogram_size = 16;
+
+    /** Wait times in microseconds. Bucket 0 counts waits below 1us, bucket i > 0 counts waits in [2^(i-1), 2^i)us.
+        The last bucket also counts all longer waits.
+     */
+    using wait_histogram = std::array<std::uint64_t, histogram_size>;
+
+    std::uint64_t push_count = 0;
+    std::uint64_t pop_count = 0;
+    std::size_t depth = 0;
+    std::size_t high_water_mark = 0;
+
+    /** Number of pushes that had to wait because the queue was at its maximum size.
+     */
+    std::uint64_t blocked_push_count = 0;
+
+    /** Number of pops that had to wait because the queue was empty.
+     */
+    std::uint64_t blocked_pop_count = 0;
+
+    /** Number of timed pushes that gave up. These are also counted as blocked, with their wait time.
+     */
+    std::uint64_t timed_out_push_count = 0;
+
+    /** Number of timed pops that gave up. These are also counted as blocked, with their wait time.
+     */
+    std::uint64_t timed_out_pop_count = 0;
+
+    /** Number of threads that are currently waiting in a push.
+     */
+    std::size_t waiting_push_count = 0;
+
+    /** Number of threads that are currently waiting in a pop.
+     */
+    std::size_t waiting_pop_count = 0;
+
+    wait_histogram push_wait_histogram{};
+    wait_histogram pop_wait_histogram{};
+};
+
+/** Statistics policy for \ref concurrent_queue that records nothing and costs nothing.
+ */
+struct no_queue_statistics
+{
+    static constexpr bool enabled = false;
+
+    void on_push(std::size_t, std::size_t)
+    {
+    }
+
+    void on_pop(std::size_t, std::size_t)
+    {
+    }
+
+    void on_push_wait(std::chrono::steady_clock::duration)
+    {
+    }
+
+    void on_pop_wait(std::chrono::steady_clock::duration)
+    {
+    }
+
+    void on_push_timeout()
+    {
+    }
+
+    void on_pop_timeout()
+    {
+    }
+};
+
+/** Statistics policy for \ref concurrent_queue that records counts, depth and wait times.
+    All hooks are called with the queue's lock held.
+ */
+class queue_statistics
+{
+public:
+    static constexpr bool enabled = true;
+
+    void on_push(std::size_t count, std::size_t depth)
+    {
+        m_snapshot.push_count += count;
+        m_snapshot.depth = depth;
+        m_snapshot.high_water_mark = std::max(m_snapshot.high_water_mark, depth);
+    }
+
+    void on_pop(std::size_t count, std::size_t depth)
+    {
+        m_snapshot.pop_count += count;
+        m_snapshot.depth = depth;
+    }
+
+    void on_push_wait(std::chrono::steady_clock::duration wait_time)
+    {
+        ++m_snapshot.blocked_push_count;
+        record(m_snapshot.push_wait_histogram, wait_time);
+    }
+
+    void on_pop_wait(std::chrono::steady_clock::duration wait_time)
+    {
+        ++m_snapshot.blocked_pop_count;
+        record(m_snapshot.pop_wait_histogram, wait_time);
+    }
+
+    void on_push_timeout()
+    {
+        ++m_snapshot.timed_out_push_count;
+    }
+
+    void on_pop_timeout()
+    {
+        ++m_snapshot.timed_out_pop_count;
+    }
+
+    queue_statistics_snapshot const& snapshot() const
+    {
+        return m_snapshot;
+    }
+
+private:
+    static void record(queue_statistics_snapshot::wait_histogram& histogram,
+                       std::chrono::steady_clock::duration wait_time)
+    {
+        auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(wait_time).count();
+        std::size_t bucket = 0;
+        while (microseconds > 0 && bucket + 1 < histogram.size())
+        {
+            microseconds >>= 1;
+            ++bucket;
+        }
+        ++histogram[bucket];
+    }
+
+    queue_statistics_snapshot m_snapshot;
+};
 
 /** Single-producer, single-consumer concurrent queue.
+    \tparam WaitPolicy Controls how a thread waits for the queue to become non-empty or non-full.
+    \tparam StatisticsPolicy Controls whether usage statistics are recorded.
+    \see blocking_wait, spin_then_block_wait, no_queue_statistics, queue_statistics
  */
-template <class T> class concurrent_queue
+template <class T, class WaitPolicy = blocking_wait, class StatisticsPolicy = no_queue_statistics>
+class concurrent_queue
 {
 public:
     void push(T value)
     {
         std::unique_lock<std::mutex> lock(m_mutex);
         m_queue.push_back(std::move(value));
+        pushed(1, clock::time_point{});
         m_push_signal.notify_one();
     }
 
     void push(T value, std::size_t max_size)
     {
+        auto const ready = [this, max_size] { return approximate_size() < max_size; };
+        auto const wait_start = start_wait(ready);
+        spin_until(ready);
+
         std::unique_lock<std::mutex> lock(m_mutex);
         if (m_queue.size() >= max_size)
         {
-            m_pop_signal.wait(lock, [this, max_size] { return m_queue.size() < max_size; });
+            wait(m_pop_signal, lock, m_waiting_push_count, [this, max_size] { return m_queue.size() < max_size; });
         }
         m_queue.push_back(std::move(value));
+        pushed(1, wait_start);
+        m_push_signal.notify_one();
+    }
+
+    /** Push a value if the queue drops below the given size before the timeout expires.
+        \returns false on timeout. The value is only copied or moved from on success.
+     */
+    template <class U = T, class Rep, class Period>
+    bool push_for(U&& value, std::size_t max_size, std::chrono::duration<Rep, Period> const& timeout)
+    {
+        return push_until(std::forward<U>(value), max_size, std::chrono::steady_clock::now() + timeout);
+    }
+
+    /** Push a value if the queue drops below the given size before the deadline.
+        \returns false on timeout. The value is only copied or moved from on success.
+     */
+    template <class U = T, class Clock, class Duration>
+    bool push_until(U&& value, std::size_t max_size, std::chrono::time_point<Clock, Duration> const& deadline)
+    {
+        auto const ready = [this, max_size] { return approximate_size() < max_size; };
+        auto const wait_start = start_wait(ready);
+        spin_until([&ready, &deadline] { return ready() || Clock::now() >= deadline; });
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!wait_until(m_pop_signal, lock, m_waiting_push_count, deadline,
+                        [this, max_size] { return m_queue.size() < max_size; }))
+        {
+            push_timed_out(wait_start);
+            return false;
+        }
+
+        m_queue.push_back(std::forward<U>(value));
+        pushed(1, wait_start);
         m_push_signal.notify_one();
+        return true;
+    }
+
+    /** Push a whole range of values with a single lock acquisition and notification.
+     */
+    template <class InputIt> void push_range(InputIt first, InputIt last)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto const size_before = m_queue.size();
+        m_queue.insert(m_queue.end(), first, last);
+        if (m_queue.size() != size_before)
+        {
+            pushed(m_queue.size() - size_before, clock::time_point{});
+            m_push_signal.notify_one();
+        }
     }
 
     T pop()
     {
+        auto const ready = [this] { return approximate_size() != 0; };
+        auto const wait_start = start_wait(ready);
+        spin_until(ready);
+
         std::unique_lock<std::mutex> lock(m_mutex);
         if (m_queue.empty())
         {
-            m_push_signal.wait(lock, [this] { return !m_queue.empty(); });
+            wait(m_push_signal, lock, m_waiting_pop_count, [this] { return !m_queue.empty(); });
         }
 
-        T result = std::move(m_queue.front());
-        m_queue.pop_front();
-        m_pop_signal.notify_one();
-        return result;
+        return take_front(wait_start);
+    }
+
+    /** Pop a value if one arrives before the timeout expires.
+     */
+    template <class Rep, class Period> std::optional<T> pop_for(std::chrono::duration<Rep, Period> const& timeout)
+    {
+        return pop_until(std::chrono::steady_clock::now() + timeout);
+    }
+
+    /** Pop a value if one arrives before the deadline.
+     */
+    template <class Clock, class Duration>
+    std::optional<T> pop_until(std::chrono::time_point<Clock, Duration> const& deadline)
+    {
+        auto const ready = [this] { return approximate_size() != 0; };
+        auto const wait_start = start_wait(ready);
+        spin_until([&ready, &deadline] { return ready() || Clock::now() >= deadline; });
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!wait_until(m_push_signal, lock, m_waiting_pop_count, deadline, [this] { return !m_queue.empty(); }))
+        {
+            pop_timed_out(wait_start);
+            return {};
+        }
+
+        return std::make_optional(take_front(wait_start));
     }
 
     std::optional<T> pop_optional()
@@ -79,16 +352,179 @@ public:
             return {};
         }
 
-        auto value = std::move(m_queue.front());
+        return std::make_optional(take_front(clock::time_point{}));
+    }
+
+    /** Move all queued values to the output iterator with a single lock acquisition, without blocking.
+        \returns The number of values that were moved.
+     */
+    template <class OutputIt> std::size_t pop_all(OutputIt output)
+    {
+        std::deque<T> batch;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_queue.empty())
+                return 0;
+
+            batch.swap(m_queue);
+            popped(batch.size(), clock::time_point{});
+            m_pop_signal.notify_one();
+        }
+
+        std::move(batch.begin(), batch.end(), output);
+        return batch.size();
+    }
+
+    /** Append all queued values to the given vector with a single lock acquisition, without blocking.
+        \returns The number of values that were appended.
+     */
+    std::size_t drain(std::vector<T>& target)
+    {
+        return pop_all(std::back_inserter(target));
+    }
+
+    /** Get a consistent copy of the recorded statistics.
+        Only available with the \ref queue_statistics policy.
+     */
+    queue_statistics_snapshot statistics()
+    {
+        static_assert(StatisticsPolicy::enabled, "Statistics are disabled for this queue");
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto result = m_statistics.snapshot();
+        result.waiting_push_count = m_waiting_push_count;
+        result.waiting_pop_count = m_waiting_pop_count;
+        return result;
+    }
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    /** Wait according to the policy without taking the lock, until the predicate holds or the policy gives up.
+     */
+    template <class Predicate> static void spin_until(Predicate ready)
+    {
+        for (std::size_t i = 0; i < WaitPolicy::spin_count; ++i)
+        {
+            if (ready())
+                return;
+            detail::cpu_relax();
+        }
+
+        for (std::size_t i = 0; i < WaitPolicy::yield_count; ++i)
+        {
+            if (ready())
+                return;
+            std::this_thread::yield();
+        }
+    }
+
+    /** Start timing a wait if the queue is not ready and statistics are enabled.
+        Returns a default-constructed time point otherwise, so this is free without statistics.
+     */
+    template <class Predicate> static clock::time_point start_wait(Predicate ready)
+    {
+        if constexpr (StatisticsPolicy::enabled)
+        {
+            if (!ready())
+                return clock::now();
+        }
+        return clock::time_point{};
+    }
+
+    /** Wait for the signal until the predicate holds, counting the thread as waiting in the meantime if statistics
+        are enabled.
+     */
+    template <class Predicate>
+    static void wait(std::condition_variable& signal, std::unique_lock<std::mutex>& lock, std::size_t& waiting_count,
+                     Predicate ready)
+    {
+        if constexpr (StatisticsPolicy::enabled)
+            ++waiting_count;
+        signal.wait(lock, ready);
+        if constexpr (StatisticsPolicy::enabled)
+            --waiting_count;
+    }
+
+    /** Wait for the signal until the predicate holds or the deadline passes, counting the thread as waiting in the
+        meantime if statistics are enabled. \returns false on timeout.
+     */
+    template <class Clock, class Duration, class Predicate>
+    static bool wait_until(std::condition_variable& signal, std::unique_lock<std::mutex>& lock,
+                           std::size_t& waiting_count, std::chrono::time_point<Clock, Duration> const& deadline,
+                           Predicate ready)
+    {
+        if constexpr (StatisticsPolicy::enabled)
+            ++waiting_count;
+        auto const result = signal.wait_until(lock, deadline, ready);
+        if constexpr (StatisticsPolicy::enabled)
+            --waiting_count;
+        return result;
+    }
+
+    std::size_t approximate_size() const
+    {
+        return m_size.load(std::memory_order_acquire);
+    }
+
+    // The following need to be called with the lock held after every change to the queue
+    void pushed(std::size_t count, clock::time_point wait_start)
+    {
+        m_size.store(m_queue.size(), std::memory_order_release);
+        if constexpr (StatisticsPolicy::enabled)
+        {
+            if (wait_start != clock::time_point{})
+                m_statistics.on_push_wait(clock::now() - wait_start);
+        }
+        m_statistics.on_push(count, m_queue.size());
+    }
+
+    void popped(std::size_t count, clock::time_point wait_start)
+    {
+        m_size.store(m_queue.size(), std::memory_order_release);
+        if constexpr (StatisticsPolicy::enabled)
+        {
+            if (wait_start != clock::time_point{})
+                m_statistics.on_pop_wait(clock::now() - wait_start);
+        }
+        m_statistics.on_pop(count, m_queue.size());
+    }
+
+    void push_timed_out(clock::time_point wait_start)
+    {
+        if constexpr (StatisticsPolicy::enabled)
+        {
+            if (wait_start != clock::time_point{})
+                m_statistics.on_push_wait(clock::now() - wait_start);
+        }
+        m_statistics.on_push_timeout();
+    }
+
+    void pop_timed_out(clock::time_point wait_start)
+    {
+        if constexpr (StatisticsPolicy::enabled)
+        {
+            if (wait_start != clock::time_point{})
+                m_statistics.on_pop_wait(clock::now() - wait_start);
+        }
+        m_statistics.on_pop_timeout();
+    }
+
+    T take_front(clock::time_point wait_start)
+    {
+        T result = std::move(m_queue.front());
         m_queue.pop_front();
+        popped(1, wait_start);
         m_pop_signal.notify_one();
-        return std::make_optional(std::move(value));
+        return result;
     }
 
-private:
     std::mutex m_mutex;
     std::condition_variable m_push_signal;
     std::condition_variable m_pop_signal;
     std::deque<T> m_queue;
+    std::atomic<std::size_t> m_size{ 0 };
+    std::size_t m_waiting_push_count = 0;
+    std::size_t m_waiting_pop_count = 0;
+    [[no_unique_address]] StatisticsPolicy m_statistics;
 };
 } // namespace replay
@@ -1,9 +1,17 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
+#include <cstdlib>
+#include <memory>
 #include <replay/aligned_allocator.hpp>
+#include <replay/bits.hpp>
+#include <replay/mask_scan.hpp>
+#include <cstring>
 #include <stdexcept>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace replay
 {
@@ -115,14 +123,12 @@ public:
     private:
         void skip_invalid_forward()
         {
-            while (index_ < parent_->smallest_key_bound_ && !parent_->element_initialized(index_))
-                ++index_;
+            index_ = parent_->next_initialized(index_);
         }
 
         void skip_invalid_backward()
         {
-            while (index_ >= 1 && !parent_->element_initialized(index_))
-                --index_;
+            index_ = parent_->previous_initialized(index_);
         }
 
         container_type* parent_;
@@ -132,6 +138,15 @@ public:
     using iterator = base_iterator<false>;
     using const_iterator = base_iterator<true>;
 
+    /** A half-open range of keys whose bounds are aligned to mask words.
+        Distinct ranges never share a mask word, so they can be processed concurrently.
+     */
+    struct key_range
+    {
+        size_type first;
+        size_type last;
+    };
+
     enum
     {
         bits_per_mask = sizeof(mask_element_type) * 8 / sizeof(std::uint8_t),
@@ -148,20 +163,22 @@ public:
         auto allocator = allocator_type();
         auto new_buffer = allocator.allocate(rhs.capacity_);
 
-        // Move all initialized elements to their new location
-        for (size_type i = 0; i < rhs.capacity_; ++i)
+        // Copy all initialized elements to their new location
+        if constexpr (is_trivially_relocatable)
         {
-            if (!rhs.element_initialized(i))
-                continue;
-
-            new (new_buffer + i) mapped_type(rhs.buffer_[i]);
+            std::memcpy(new_buffer, rhs.buffer_, rhs.smallest_key_bound_ * sizeof(mapped_type));
+        }
+        else
+        {
+            rhs.for_each_initialized([&](size_type key) { new (new_buffer + key) mapped_type(rhs.buffer_[key]); });
         }
 
         // Create and initialize a new mask
-        auto const mask_size = mask_size_for(rhs.capacity_);
+        auto const mask_size = detail::mask_word_count(rhs.capacity_);
         auto const new_mask = new mask_element_type[mask_size];
         std::copy(rhs.mask_, rhs.mask_ + mask_size, new_mask);
 
+        size_ = rhs.size_;
         capacity_ = rhs.capacity_;
         smallest_key_bound_ = rhs.smallest_key_bound_;
         buffer_ = new_buffer;
@@ -180,14 +197,7 @@ public:
 
     ~index_map()
     {
-        for (std::size_t key = 0; key < smallest_key_bound_; ++key)
-        {
-            if (!element_initialized(key))
-                continue;
-            
-            buffer_[key].~mapped_type();
-        }
-
+        for_each_initialized([this](size_type key) { buffer_[key].~mapped_type(); });
         free_memory();
     }
 
@@ -233,12 +243,7 @@ public:
         mask_[key / bits_per_mask] &= ~((mask_element_type{ 1 } << (key % bits_per_mask)));
 
         if ((key + 1) == smallest_key_bound_)
-        {
-            --smallest_key_bound_;
-
-            while (smallest_key_bound_ > 0 && !element_initialized(smallest_key_bound_ - 1))
-                --smallest_key_bound_;
-        }
+            smallest_key_bound_ = detail::set_bits_bound(mask_, key);
     }
 
     void erase(iterator it)
@@ -340,31 +345,43 @@ public:
         if (new_capacity <= capacity_)
             return;
 
-        // Allocate new buffers
-        auto allocator = allocator_type();
-        auto new_buffer = allocator.allocate(new_capacity);
-
-        // Move all initialized elements to their new location
-        for (size_type i = 0; i < capacity_; ++i)
-        {
-            if (!element_initialized(i))
-                continue;
-
-            new (new_buffer + i) mapped_type(std::move(buffer_[i]));
-            (buffer_[i]).~mapped_type();
-        }
-
         // Create and initialize a new mask
-        auto const current_mask_size = mask_size_for(capacity_);
-        auto const new_mask_size = mask_size_for(new_capacity);
+        auto const current_mask_size = detail::mask_word_count(capacity_);
+        auto const new_mask_size = detail::mask_word_count(new_capacity);
 
         auto const new_mask = new mask_element_type[new_mask_size];
         std::copy(mask_, mask_ + current_mask_size, new_mask);
         std::fill(new_mask + current_mask_size, new_mask + new_mask_size, mask_element_type{ 0 });
 
-        free_memory();
+        auto allocator = allocator_type();
+        if constexpr (is_trivially_relocatable)
+        {
+            // Let the allocator grow the buffer, which avoids the copy if it can be extended in place
+            try
+            {
+                buffer_ = allocator.reallocate(buffer_, capacity_, new_capacity);
+            }
+            catch (...)
+            {
+                delete[] new_mask;
+                throw;
+            }
+
+            delete[] mask_;
+        }
+        else
+        {
+            // Move all initialized elements to their new location
+            auto new_buffer = allocator.allocate(new_capacity);
+            for_each_initialized([&](size_type key) {
+                new (new_buffer + key) mapped_type(std::move(buffer_[key]));
+                (buffer_[key]).~mapped_type();
+            });
+
+            free_memory();
+            buffer_ = new_buffer;
+        }
 
-        buffer_ = new_buffer;
         mask_ = new_mask;
         capacity_ = new_capacity;
     }
@@ -399,25 +416,13 @@ public:
         if (size_ != rhs.size_ || smallest_key_bound_ != rhs.smallest_key_bound_)
             return false;
 
-        auto const B = smallest_key_bound_;
-        for (std::size_t i = 0; i < B; ++i)
-        {
-            if (element_initialized(i))
-            {
-                if (!rhs.element_initialized(i))
-                    return false;
-
-                if (!(this->operator[](i) == rhs[i]))
-                    return false;
-            }
-            else
-            {
-                if (rhs.element_initialized(i))
-                    return false;
-            }
-        }
+        auto const word_count = detail::mask_word_count(smallest_key_bound_);
+        if (!std::equal(mask_, mask_ + word_count, rhs.mask_))
+            return false;
 
-        return true;
+        bool equal = true;
+        for_each_initialized([&](size_type key) { equal = equal && (*this)[key] == rhs[key]; });
+        return equal;
     }
 
     bool operator!=(index_map const& rhs) const
@@ -427,17 +432,8 @@ public:
 
     void clear()
     {
-        auto const B = smallest_key_bound_;
-        for (std::size_t i = 0; i < B; ++i)
-        {
-            if (!element_initialized(i))
-                continue;
-
-            (buffer_[i]).~mapped_type();
-        }
-
-        for (std::size_t i = 0; i < mask_size_for(capacity_); ++i)
-            mask_[i] = 0;
+        for_each_initialized([this](size_type key) { (buffer_[key]).~mapped_type(); });
+        std::fill(mask_, mask_ + detail::mask_word_count(smallest_key_bound_), mask_element_type{ 0 });
 
         size_ = 0;
         smallest_key_bound_ = 0;
@@ -447,17 +443,46 @@ public:
     size_type remove_if(BinaryPredicate p)
     {
         size_type removal_count = 0;
-        for (auto i = begin(), ie = end(); i != ie; ++i)
-        {
-            if (!p(i.key(), *i))
-                continue;
+        for_each_initialized([&](size_type key) {
+            if (!p(key, buffer_[key]))
+                return;
 
-            erase(i);
+            erase(key);
             ++removal_count;
-        }
+        });
         return removal_count;
     }
 
+    /** Split the used key space into mask word aligned ranges of at least the given size.
+     */
+    std::vector<key_range> split_key_ranges(size_type min_keys_per_range) const
+    {
+        auto const words_per_range = std::max<size_type>(1, detail::mask_word_count(min_keys_per_range));
+        auto const word_count = detail::mask_word_count(smallest_key_bound_);
+
+        std::vector<key_range> result;
+        for (size_type word = 0; word < word_count; word += words_per_range)
+        {
+            auto const last_word = std::min(word + words_per_range, word_count);
+            result.push_back({ word * bits_per_mask, std::min(last_word * bits_per_mask, smallest_key_bound_) });
+        }
+        return result;
+    }
+
+    /** Call function(key, value) for all elements with a key in the given range, in ascending key order.
+     */
+    template <class Function> void for_each_in(key_range const& range, Function&& function)
+    {
+        for_each_initialized_in(range, [&](size_type key) { function(key, buffer_[key]); });
+    }
+
+    /** Call function(key, value) for all elements with a key in the given range, in ascending key order.
+     */
+    template <class Function> void for_each_in(key_range const& range, Function&& function) const
+    {
+        for_each_initialized_in(range, [&](size_type key) { function(key, buffer_[key]); });
+    }
+
     /** The smallest number so that all keys are smaller than this.
     */
     size_type smallest_key_bound() const
@@ -466,6 +491,10 @@ public:
     }
 
 private:
+    /** Whether elements can be copied and relocated as raw bytes, without calling constructors.
+     */
+    static constexpr bool is_trivially_relocatable = std::is_trivially_copyable<mapped_type>::value;
+
     void free_memory()
     {
         if (buffer_ != nullptr)
@@ -489,22 +518,46 @@ private:
         return mask_[index / bits_per_mask] & (mask_element_type{ 1 } << (index % bits_per_mask));
     }
 
-    size_type mask_size_for(size_type capacity)
+    /** The smallest initialized key that is not smaller than the given key, or the smallest key bound.
+        Keys that are already past the bound are returned unchanged. Skips whole mask words at once.
+     */
+    size_type next_initialized(size_type key) const
+    {
+        if (key >= smallest_key_bound_)
+            return key;
+
+        return detail::next_set_bit(mask_, key, smallest_key_bound_);
+    }
+
+    /** The largest initialized key that is not larger than the given key, or 0 if there is none.
+        Skips whole mask words at once.
+     */
+    size_type previous_initialized(size_type key) const
+    {
+        if (capacity_ == 0)
+            return 0;
+
+        auto const bound = detail::set_bits_bound(mask_, std::min(key, capacity_ - 1) + 1);
+        return bound > 0 ? bound - 1 : 0;
+    }
+
+    /** Call the function for all initialized keys in ascending order.
+        Each mask word is read before its keys are visited, so the function may erase the key it is given.
+     */
+    template <class Function> void for_each_initialized(Function function) const
+    {
+        for_each_initialized_in({ 0, smallest_key_bound_ }, function);
+    }
+
+    template <class Function> void for_each_initialized_in(key_range const& range, Function function) const
     {
-        auto constexpr bits_per_mask = sizeof(mask_element_type) * 8 / sizeof(std::uint8_t);
-        return (capacity + bits_per_mask - 1) / bits_per_mask;
+        detail::for_each_set_bit(mask_, range.first, std::min(range.last, smallest_key_bound_), function);
     }
 
     void size_to_include(size_type key)
     {
         // Exponentially grow the buffers
-        auto next_capacity = capacity_ > 0 ? capacity_ : 1;
-        while (next_capacity <= key)
-        {
-            next_capacity = 2 * next_capacity;
-        }
-
-        reserve(next_capacity);
+        reserve(detail::capacity_to_include(capacity_, key));
     }
 
     size_type size_ = 0;
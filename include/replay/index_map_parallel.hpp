@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <replay/index_map.hpp>
+#include <replay/thread_pool.hpp>
+#include <utility>
+
+namespace replay
+{
+
+/** Call function(key, value) for all elements of the map in parallel.
+    The key space is split along mask words, so the function may freely modify the value it is given.
+    It must not insert or erase elements.
+    \param min_keys_per_task Minimum size of the key range processed by a single task, or 0 to choose automatically.
+ */
+template <class T, class Function>
+void parallel_for_each(thread_pool& pool, index_map<T>& map, Function&& function, std::size_t min_keys_per_task = 0)
+{
+    using key_range = typename index_map<T>::key_range;
+    auto const bits_per_mask = std::size_t{ index_map<T>::bits_per_mask };
+    auto const word_count = (map.smallest_key_bound() + bits_per_mask - 1) / bits_per_mask;
+    auto const words_per_task = (min_keys_per_task + bits_per_mask - 1) / bits_per_mask;
+
+    parallel_for(pool, 0, word_count, words_per_task, [&](std::size_t first_word, std::size_t last_word) {
+        map.for_each_in(key_range{ first_word * bits_per_mask, last_word * bits_per_mask }, function);
+    });
+}
+
+/** Call function(key, value) for all elements of the map in parallel on the shared thread pool.
+ */
+template <class T, class Function>
+void parallel_for_each(index_map<T>& map, Function&& function, std::size_t min_keys_per_task = 0)
+{
+    parallel_for_each(thread_pool::shared(), map, std::forward<Function>(function), min_keys_per_task);
+}
+
+} // namespace replay
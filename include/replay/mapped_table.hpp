@@ -0,0 +1,254 @@
+/*
+replay
+Software Library
+
+Copyright (c) 2010-2019 Marius Elvert
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <replay/table_view.hpp>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+namespace replay
+{
+
+/** How a \ref mapped_file makes the file's contents accessible.
+ */
+enum class map_mode
+{
+    /** Pages are only readable. */
+    read_only,
+
+    /** Pages are writable, but changes stay private to the mapping and are never written back to the file. */
+    copy_on_write
+};
+
+/** A whole file mapped into memory.
+    Pages are only loaded from disk when they are first accessed.
+    \note Uses mmap on POSIX systems and file mappings on Windows.
+*/
+class mapped_file
+{
+public:
+    /** Map a file.
+        \throws std::system_error if the file cannot be opened or mapped.
+    */
+    mapped_file(std::filesystem::path const& filename, map_mode mode);
+
+    mapped_file(mapped_file&& rhs) noexcept;
+    mapped_file& operator=(mapped_file&& rhs) noexcept;
+
+    mapped_file(mapped_file const&) = delete;
+    mapped_file& operator=(mapped_file const&) = delete;
+
+    /** Unmap the file.
+     */
+    ~mapped_file();
+
+    /** Pointer to the start of the mapping.
+     */
+    char* data() const
+    {
+        return m_data;
+    }
+
+    /** Size of the mapping in bytes, i.e. the file size.
+     */
+    std::size_t size() const
+    {
+        return m_size;
+    }
+
+    map_mode mode() const
+    {
+        return m_mode;
+    }
+
+private:
+    void unmap() noexcept;
+
+    char* m_data;
+    std::size_t m_size;
+    map_mode m_mode;
+};
+
+/** Exception that is thrown when a file is not a valid table file.
+ */
+class mapped_table_format_error : public std::runtime_error
+{
+public:
+    /** Initialize with an error string.
+     */
+    explicit mapped_table_format_error(const std::string& str)
+    : std::runtime_error(str)
+    {
+    }
+};
+
+/** Header at the start of a table file, followed by the raw row-major elements at data_offset.
+    All fields and elements are stored in native byte order.
+*/
+struct mapped_table_header
+{
+    static constexpr char expected_magic[8] = { 'R', 'P', 'L', 'T', 'A', 'B', 'L', 'E' };
+    static constexpr std::uint32_t current_version = 1;
+
+    /** Size of the header, so that the elements start on a cache line.
+     */
+    static constexpr std::uint64_t default_data_offset = 64;
+
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t element_size;
+    std::uint64_t width;
+    std::uint64_t height;
+    std::uint64_t data_offset;
+};
+
+static_assert(sizeof(mapped_table_header) <= mapped_table_header::default_data_offset, "Header too large");
+
+/** Write a table file that can be opened as a \ref mapped_table.
+    \throws std::runtime_error if the file cannot be written.
+*/
+template <class T> void save_mapped_table(std::filesystem::path const& filename, const_table_view<T> source)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be stored in a file");
+
+    mapped_table_header header{};
+    std::memcpy(header.magic, mapped_table_header::expected_magic, sizeof(header.magic));
+    header.version = mapped_table_header::current_version;
+    header.element_size = sizeof(T);
+    header.width = source.width();
+    header.height = source.height();
+    header.data_offset = mapped_table_header::default_data_offset;
+
+    std::ofstream file(filename, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    char padding[mapped_table_header::default_data_offset] = {};
+    file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    file.write(padding, header.data_offset - sizeof(header));
+    for (std::size_t y = 0; y < source.height(); ++y)
+        file.write(reinterpret_cast<char const*>(source.row(y)), sizeof(T) * source.width());
+
+    if (!file.good())
+        throw std::runtime_error("Unable to write table file " + filename.string());
+}
+
+/** Write a table file that can be opened as a \ref mapped_table.
+ */
+template <class T, class Layout>
+void save_mapped_table(std::filesystem::path const& filename, table<T, Layout> const& source)
+{
+    save_mapped_table(filename, const_table_view<T>(source));
+}
+
+/** A table whose elements live in a memory-mapped file instead of the heap.
+    Opening is constant-time and only the touched pages are read from disk.
+    \tparam Mode With \ref map_mode::read_only, elements can only be read. With \ref map_mode::copy_on_write, they can
+    be modified in memory, but the changes are never written back.
+    \see save_mapped_table
+*/
+template <class T, map_mode Mode = map_mode::read_only> class mapped_table
+{
+public:
+    static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be stored in a file");
+
+    typedef std::conditional_t<Mode == map_mode::read_only, T const, T> value_type;
+    typedef std::size_t size_type;
+
+    /** Map a table file.
+        \throws std::system_error if the file cannot be mapped.
+        \throws mapped_table_format_error if the file is not a table file for this element type.
+    */
+    explicit mapped_table(std::filesystem::path const& filename)
+    : m_file(filename, Mode)
+    {
+        mapped_table_header header;
+        if (m_file.size() < sizeof(header))
+            throw mapped_table_format_error("File too small for a table header");
+
+        std::memcpy(&header, m_file.data(), sizeof(header));
+        if (std::memcmp(header.magic, mapped_table_header::expected_magic, sizeof(header.magic)) != 0)
+            throw mapped_table_format_error("Not a table file");
+        if (header.version != mapped_table_header::current_version)
+            throw mapped_table_format_error("Unsupported table file version");
+        if (header.element_size != sizeof(T))
+            throw mapped_table_format_error("Element size does not match");
+        if (header.data_offset % alignof(T) != 0 || header.data_offset > m_file.size() ||
+            (header.width && header.height > (m_file.size() - header.data_offset) / sizeof(T) / header.width))
+            throw mapped_table_format_error("Table data exceeds the file");
+
+        auto const origin = reinterpret_cast<value_type*>(m_file.data() + header.data_offset);
+        m_view = table_view<value_type>(origin, static_cast<size_type>(header.width),
+                                        static_cast<size_type>(header.height));
+    }
+
+    /** Access the table.
+        \param x The column in the table.
+        \param y The row in the table.
+    */
+    value_type& operator()(size_type x, size_type y) const
+    {
+        return m_view(x, y);
+    }
+
+    /** View of all elements, e.g. to use with the table algorithms.
+     */
+    table_view<value_type> view() const
+    {
+        return m_view;
+    }
+
+    /** Get the width of the table, i.e. the number of columns.
+     */
+    size_type width() const
+    {
+        return m_view.width();
+    }
+
+    /** Get the height of the table, i.e. the number of rows.
+     */
+    size_type height() const
+    {
+        return m_view.height();
+    }
+
+    /** Pointer to the first element. The elements are contiguous and row-major.
+     */
+    value_type* ptr() const
+    {
+        return m_view.ptr();
+    }
+
+private:
+    mapped_file m_file;
+    table_view<value_type> m_view;
+};
+
+} // namespace replay
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <replay/bits.hpp>
+
+namespace replay
+{
+namespace detail
+{
+
+/** Scanning helpers for the occupancy masks of \ref index_map and its variants.
+    A mask is an array of 64 bit words where bit i is set if key i is used. The helpers work on plain words as
+    well as on atomic words, which are read with acquire semantics.
+ */
+using mask_word = std::uint64_t;
+
+constexpr std::size_t bits_per_mask_word = 64;
+
+/** Number of mask words needed for the given number of keys.
+ */
+inline std::size_t mask_word_count(std::size_t key_count)
+{
+    return (key_count + bits_per_mask_word - 1) / bits_per_mask_word;
+}
+
+inline mask_word load_mask_word(mask_word const& word)
+{
+    return word;
+}
+
+inline mask_word load_mask_word(std::atomic<mask_word> const& word)
+{
+    return word.load(std::memory_order_acquire);
+}
+
+/** The smallest set bit in [first, last), or last if there is none. Skips whole words at once.
+ */
+template <class Word> std::size_t next_set_bit(Word const* mask, std::size_t first, std::size_t last)
+{
+    if (first >= last)
+        return last;
+
+    auto const word_count = mask_word_count(last);
+    auto word_index = first / bits_per_mask_word;
+    auto word = load_mask_word(mask[word_index]) & (~mask_word{ 0 } << (first % bits_per_mask_word));
+    while (word == 0)
+    {
+        if (++word_index == word_count)
+            return last;
+        word = load_mask_word(mask[word_index]);
+    }
+    return std::min(word_index * bits_per_mask_word + count_trailing_zeros(word), last);
+}
+
+/** One past the largest set bit in [0, last), or 0 if there is none. Skips whole words at once.
+ */
+template <class Word> std::size_t set_bits_bound(Word const* mask, std::size_t last)
+{
+    if (last == 0)
+        return 0;
+
+    auto const key = last - 1;
+    auto word_index = key / bits_per_mask_word;
+    auto word = load_mask_word(mask[word_index]) &
+                (~mask_word{ 0 } >> (bits_per_mask_word - 1 - key % bits_per_mask_word));
+    while (word == 0)
+    {
+        if (word_index == 0)
+            return 0;
+        word = load_mask_word(mask[--word_index]);
+    }
+    return word_index * bits_per_mask_word + (bits_per_mask_word - count_leading_zeros(word));
+}
+
+/** Call function(key) for all set bits in [first, last) in ascending order.
+    Each word is read before its keys are visited, so the function may clear the bit it is given.
+ */
+template <class Word, class Function>
+void for_each_set_bit(Word const* mask, std::size_t first, std::size_t last, Function&& function)
+{
+    if (first >= last)
+        return;
+
+    auto const first_word = first / bits_per_mask_word;
+    auto const last_word = mask_word_count(last);
+    for (auto word_index = first_word; word_index < last_word; ++word_index)
+    {
+        auto word = load_mask_word(mask[word_index]);
+        if (word_index == first_word)
+            word &= ~mask_word{ 0 } << (first % bits_per_mask_word);
+        if (word_index + 1 == last_word && last % bits_per_mask_word != 0)
+            word &= ~(~mask_word{ 0 } << (last % bits_per_mask_word));
+
+        for (; word != 0; word &= word - 1)
+            function(word_index * bits_per_mask_word + count_trailing_zeros(word));
+    }
+}
+
+/** Capacity after growing exponentially until the key fits.
+ */
+inline std::size_t capacity_to_include(std::size_t capacity, std::size_t key)
+{
+    auto result = capacity > 0 ? capacity : 1;
+    while (result <= key)
+        result *= 2;
+    return result;
+}
+
+} // namespace detail
+} // namespace replay
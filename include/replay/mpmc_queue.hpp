@@ -0,0 +1,235 @@
+/*
+replay
+Software Library
+
+Copyright (c) 2010-2019 Marius Elvert
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <replay/common.hpp>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+
+namespace replay
+{
+
+/** Bounded, lock-free multi-producer, multi-consumer queue.
+    Every slot of the ring buffer carries a sequence number that tells producers and consumers whether it is
+    free or filled for the current lap, so threads only contend on the slot they are claiming (Dmitry Vyukov's
+    bounded MPMC queue). The capacity is a power of two.
+    Use \ref spsc_queue if there is only a single producer and consumer.
+ */
+template <class T> class mpmc_queue
+{
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+
+    /** Create a queue that can hold at least the given number of elements.
+        The capacity is rounded up to the next power of two, and is at least two.
+     */
+    explicit mpmc_queue(size_type min_capacity)
+    : m_capacity(detail::round_up_to_power_of_two(min_capacity, 2))
+    , m_mask(m_capacity - 1)
+    , m_cells(new cell[m_capacity])
+    {
+        for (size_type i = 0; i < m_capacity; ++i)
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    mpmc_queue(mpmc_queue const&) = delete;
+    mpmc_queue& operator=(mpmc_queue const&) = delete;
+
+    ~mpmc_queue()
+    {
+        while (try_pop())
+        {
+        }
+    }
+
+    /** Try to add an element, without blocking.
+        If constructing the element throws, the claimed slot is published as empty and skipped by consumers.
+        \returns false if the queue is full. The value is left untouched in that case.
+     */
+    template <class U> bool try_push(U&& value)
+    {
+        auto position = m_enqueue_position.load(std::memory_order_relaxed);
+        cell* target;
+        while (true)
+        {
+            target = &m_cells[position & m_mask];
+            auto const sequence = target->sequence.load(std::memory_order_acquire);
+            auto const difference = static_cast<std::intptr_t>(sequence - position);
+
+            if (difference == 0)
+            {
+                if (m_enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = m_enqueue_position.load(std::memory_order_relaxed);
+            }
+        }
+
+        try
+        {
+            new (&target->storage) value_type(std::forward<U>(value));
+        }
+        catch (...)
+        {
+            // The slot is claimed already, so consumers would wait for it forever unless it is published
+            target->empty = true;
+            target->sequence.store(position + 1, std::memory_order_release);
+            throw;
+        }
+
+        target->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** Try to remove an element, without blocking.
+        If moving the element out throws, it is dropped and the exception is passed on.
+        \returns The element, or nothing if the queue is empty.
+     */
+    std::optional<value_type> try_pop()
+    {
+        auto position = m_dequeue_position.load(std::memory_order_relaxed);
+        cell* source;
+        while (true)
+        {
+            source = &m_cells[position & m_mask];
+            auto const sequence = source->sequence.load(std::memory_order_acquire);
+            auto const difference = static_cast<std::intptr_t>(sequence - (position + 1));
+
+            if (difference == 0)
+            {
+                if (!m_dequeue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    continue;
+
+                if (!source->empty)
+                    break;
+
+                // Skip slots of failed pushes
+                source->empty = false;
+                source->sequence.store(position + m_capacity, std::memory_order_release);
+                position = m_dequeue_position.load(std::memory_order_relaxed);
+            }
+            else if (difference < 0)
+            {
+                return {};
+            }
+            else
+            {
+                position = m_dequeue_position.load(std::memory_order_relaxed);
+            }
+        }
+
+        auto& slot = *std::launder(reinterpret_cast<value_type*>(&source->storage));
+        std::optional<value_type> result;
+        try
+        {
+            result.emplace(std::move(slot));
+        }
+        catch (...)
+        {
+            // The value is lost, but the slot still has to be released or producers would wait for it forever
+            slot.~value_type();
+            source->sequence.store(position + m_capacity, std::memory_order_release);
+            throw;
+        }
+
+        slot.~value_type();
+        source->sequence.store(position + m_capacity, std::memory_order_release);
+        return result;
+    }
+
+    /** Add an element, waiting for free space if the queue is full.
+        Waiting spins and yields the thread, so this is meant for queues that are rarely full.
+     */
+    template <class U> void push(U&& value)
+    {
+        while (!try_push(std::forward<U>(value)))
+            std::this_thread::yield();
+    }
+
+    /** Remove an element, waiting for one to arrive if the queue is empty.
+        Waiting spins and yields the thread, so this is meant for queues that are rarely empty.
+     */
+    value_type pop()
+    {
+        while (true)
+        {
+            if (auto result = try_pop())
+                return std::move(*result);
+
+            std::this_thread::yield();
+        }
+    }
+
+    /** Approximate number of elements in the queue. Slots of failed pushes count until they are skipped.
+     */
+    size_type size() const
+    {
+        auto const dequeue_position = m_dequeue_position.load(std::memory_order_acquire);
+        auto const enqueue_position = m_enqueue_position.load(std::memory_order_acquire);
+        return enqueue_position > dequeue_position ? enqueue_position - dequeue_position : 0;
+    }
+
+    /** The maximum number of elements the queue can hold.
+     */
+    size_type capacity() const
+    {
+        return m_capacity;
+    }
+
+private:
+    struct cell
+    {
+        std::atomic<size_type> sequence;
+        bool empty = false; // Published without a value because constructing it threw
+        std::aligned_storage_t<sizeof(value_type), alignof(value_type)> storage;
+    };
+
+    // Contended by the producers
+    alignas(cache_line_size) std::atomic<size_type> m_enqueue_position{ 0 };
+
+    // Contended by the consumers
+    alignas(cache_line_size) std::atomic<size_type> m_dequeue_position{ 0 };
+
+    // Read-only after construction
+    alignas(cache_line_size) size_type const m_capacity;
+    size_type const m_mask;
+    std::unique_ptr<cell[]> const m_cells;
+};
+} // namespace replay
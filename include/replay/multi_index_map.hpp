@@ -0,0 +1,504 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <replay/aligned_allocator.hpp>
+#include <replay/mask_scan.hpp>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace replay
+{
+
+/** Variant of \ref index_map that stores several columns of values per key in structure-of-arrays layout.
+    All columns share a single occupancy mask and key space, so inserting or erasing a key touches one bit and
+    checks for growth once. Each column is a contiguous array indexed by key, so loops that only need one column
+    stream through exactly that memory.
+*/
+template <class... Ts> class multi_index_map
+{
+public:
+    using size_type = std::size_t;
+    using key_type = size_type;
+    using mask_element_type = std::uint64_t;
+    using reference = std::tuple<Ts&...>;
+    using const_reference = std::tuple<Ts const&...>;
+
+    template <std::size_t I> using column_type = std::tuple_element_t<I, std::tuple<Ts...>>;
+
+    static constexpr std::size_t column_count = sizeof...(Ts);
+
+    enum
+    {
+        bits_per_mask = sizeof(mask_element_type) * 8 / sizeof(std::uint8_t),
+    };
+
+    template <bool Const> class base_iterator
+    {
+    public:
+        using value_type =
+            std::conditional_t<Const, typename multi_index_map::const_reference, typename multi_index_map::reference>;
+        using reference = value_type;
+        using pointer = void;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::forward_iterator_tag;
+
+        using container_type = std::conditional_t<Const, std::add_const_t<multi_index_map>, multi_index_map>;
+
+        base_iterator(container_type* parent, size_type index)
+        : parent_(parent)
+        , index_(parent->next_initialized(index))
+        {
+        }
+
+        base_iterator& operator++()
+        {
+            index_ = parent_->next_initialized(index_ + 1);
+            return *this;
+        }
+
+        base_iterator operator++(int)
+        {
+            auto result = *this;
+            ++(*this);
+            return result;
+        }
+
+        /** Tuple of references to all columns of the current element.
+         */
+        value_type operator*() const
+        {
+            return (*parent_)[index_];
+        }
+
+        size_type key() const
+        {
+            return index_;
+        }
+
+        template <bool OtherConst> bool operator==(base_iterator<OtherConst> const& rhs) const
+        {
+            return index_ == rhs.key();
+        }
+
+        template <bool OtherConst> bool operator!=(base_iterator<OtherConst> const& rhs) const
+        {
+            return index_ != rhs.key();
+        }
+
+    private:
+        container_type* parent_;
+        size_type index_;
+    };
+
+    using iterator = base_iterator<false>;
+    using const_iterator = base_iterator<true>;
+
+    multi_index_map() = default;
+
+    multi_index_map(multi_index_map const& rhs)
+    {
+        if (!rhs.capacity_)
+            return;
+
+        // The destructor does not run if this throws, so clean up the partial copy by hand
+        try
+        {
+            reserve(rhs.capacity_);
+            rhs.for_each_initialized([&](size_type key) {
+                construct_from_row(key, std::index_sequence_for<Ts...>{}, rhs[key]);
+                mark_inserted(key);
+            });
+        }
+        catch (...)
+        {
+            clear();
+            free_memory();
+            throw;
+        }
+    }
+
+    multi_index_map(multi_index_map&& rhs) noexcept
+    : size_(rhs.size_)
+    , capacity_(rhs.capacity_)
+    , smallest_key_bound_(rhs.smallest_key_bound_)
+    , columns_(rhs.columns_)
+    , mask_(rhs.mask_)
+    {
+        rhs.null_out();
+    }
+
+    ~multi_index_map()
+    {
+        clear();
+        free_memory();
+    }
+
+    multi_index_map& operator=(multi_index_map const& rhs)
+    {
+        *this = multi_index_map(rhs); // copy-construct and move
+        return *this;
+    }
+
+    multi_index_map& operator=(multi_index_map&& rhs) noexcept
+    {
+        if (&rhs == this)
+            return *this;
+
+        clear();
+        free_memory();
+        size_ = rhs.size_;
+        capacity_ = rhs.capacity_;
+        smallest_key_bound_ = rhs.smallest_key_bound_;
+        columns_ = rhs.columns_;
+        mask_ = rhs.mask_;
+
+        rhs.null_out();
+        return *this;
+    }
+
+    bool empty() const
+    {
+        return size_ == 0;
+    }
+
+    size_type size() const
+    {
+        return size_;
+    }
+
+    size_type capacity() const
+    {
+        return capacity_;
+    }
+
+    /** The smallest number so that all keys are smaller than this.
+    */
+    size_type smallest_key_bound() const
+    {
+        return smallest_key_bound_;
+    }
+
+    bool contains(key_type key) const
+    {
+        return key < capacity_ && element_initialized(key);
+    }
+
+    /** Insert a value for each column, unless the key is already used.
+        \returns false if the key was already used.
+     */
+    template <class... Args> bool insert(key_type key, Args&&... values)
+    {
+        static_assert(sizeof...(Args) == column_count, "Need exactly one value per column");
+        size_to_include(key);
+
+        if (element_initialized(key))
+            return false;
+
+        construct(key, std::index_sequence_for<Ts...>{}, std::forward<Args>(values)...);
+        mark_inserted(key);
+        return true;
+    }
+
+    void erase(key_type key)
+    {
+        if (!contains(key))
+            return;
+
+        destroy(key, std::index_sequence_for<Ts...>{});
+        --size_;
+        mask_[key / bits_per_mask] &= ~(mask_element_type{ 1 } << (key % bits_per_mask));
+
+        if ((key + 1) == smallest_key_bound_)
+            smallest_key_bound_ = detail::set_bits_bound(mask_, key);
+    }
+
+    void erase(iterator it)
+    {
+        erase(it.key());
+    }
+
+    /** Access all columns of an element.
+     */
+    reference operator[](key_type key)
+    {
+        return row(key, std::index_sequence_for<Ts...>{});
+    }
+
+    /** Access all columns of an element.
+     */
+    const_reference operator[](key_type key) const
+    {
+        return row(key, std::index_sequence_for<Ts...>{});
+    }
+
+    reference at(key_type key)
+    {
+        check_contains(key);
+        return (*this)[key];
+    }
+
+    const_reference at(key_type key) const
+    {
+        check_contains(key);
+        return (*this)[key];
+    }
+
+    /** Access a single column of an element.
+     */
+    template <std::size_t I> column_type<I>& get(key_type key)
+    {
+        return std::get<I>(columns_)[key];
+    }
+
+    /** Access a single column of an element.
+     */
+    template <std::size_t I> column_type<I> const& get(key_type key) const
+    {
+        return std::get<I>(columns_)[key];
+    }
+
+    /** Raw pointer to a column, indexed by key. Only initialized keys may be accessed.
+     */
+    template <std::size_t I> column_type<I>* column()
+    {
+        return std::get<I>(columns_);
+    }
+
+    /** Raw pointer to a column, indexed by key. Only initialized keys may be accessed.
+     */
+    template <std::size_t I> column_type<I> const* column() const
+    {
+        return std::get<I>(columns_);
+    }
+
+    /** Call function(key, column values...) for all elements in ascending key order.
+     */
+    template <class Function> void for_each(Function&& function)
+    {
+        for_each_initialized([&](size_type key) {
+            std::apply([&](auto&... values) { function(key, values...); }, (*this)[key]);
+        });
+    }
+
+    /** Call function(key, column values...) for all elements in ascending key order.
+     */
+    template <class Function> void for_each(Function&& function) const
+    {
+        for_each_initialized([&](size_type key) {
+            std::apply([&](auto&... values) { function(key, values...); }, (*this)[key]);
+        });
+    }
+
+    /** Call function(key, value) for a single column of all elements in ascending key order.
+     */
+    template <std::size_t I, class Function> void for_each_in_column(Function&& function)
+    {
+        auto const values = std::get<I>(columns_);
+        for_each_initialized([&](size_type key) { function(key, values[key]); });
+    }
+
+    /** Call function(key, value) for a single column of all elements in ascending key order.
+     */
+    template <std::size_t I, class Function> void for_each_in_column(Function&& function) const
+    {
+        auto const values = std::get<I>(columns_);
+        for_each_initialized([&](size_type key) { function(key, static_cast<column_type<I> const&>(values[key])); });
+    }
+
+    iterator begin()
+    {
+        return iterator(this, 0);
+    }
+
+    iterator end()
+    {
+        return iterator(this, smallest_key_bound_);
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(this, smallest_key_bound_);
+    }
+
+    void clear()
+    {
+        for_each_initialized([this](size_type key) { destroy(key, std::index_sequence_for<Ts...>{}); });
+        std::fill(mask_, mask_ + detail::mask_word_count(smallest_key_bound_), mask_element_type{ 0 });
+        size_ = 0;
+        smallest_key_bound_ = 0;
+    }
+
+    void reserve(size_type new_capacity)
+    {
+        // Can only increase
+        if (new_capacity <= capacity_)
+            return;
+
+        auto const current_mask_size = detail::mask_word_count(capacity_);
+        auto const new_mask_size = detail::mask_word_count(new_capacity);
+        auto const new_mask = new mask_element_type[new_mask_size];
+        std::copy(mask_, mask_ + current_mask_size, new_mask);
+        std::fill(new_mask + current_mask_size, new_mask + new_mask_size, mask_element_type{ 0 });
+
+        try
+        {
+            grow_columns(new_capacity, std::index_sequence_for<Ts...>{});
+        }
+        catch (...)
+        {
+            delete[] new_mask;
+            throw;
+        }
+
+        delete[] mask_;
+        mask_ = new_mask;
+        capacity_ = new_capacity;
+    }
+
+private:
+    using columns_type = std::tuple<Ts*...>;
+
+    template <std::size_t... I, class... Args>
+    void construct(key_type key, std::index_sequence<I...>, Args&&... values)
+    {
+        std::size_t constructed = 0;
+        try
+        {
+            ((new (std::get<I>(columns_) + key) column_type<I>(std::forward<Args>(values)), ++constructed), ...);
+        }
+        catch (...)
+        {
+            ((I < constructed ? std::get<I>(columns_)[key].~column_type<I>() : void()), ...);
+            throw;
+        }
+    }
+
+    template <std::size_t... I, class Tuple>
+    void construct_from_row(key_type key, std::index_sequence<I...> sequence, Tuple const& row)
+    {
+        construct(key, sequence, std::get<I>(row)...);
+    }
+
+    template <std::size_t... I> void destroy(key_type key, std::index_sequence<I...>)
+    {
+        (std::get<I>(columns_)[key].~column_type<I>(), ...);
+    }
+
+    template <std::size_t... I> reference row(key_type key, std::index_sequence<I...>)
+    {
+        return reference(std::get<I>(columns_)[key]...);
+    }
+
+    template <std::size_t... I> const_reference row(key_type key, std::index_sequence<I...>) const
+    {
+        return const_reference(std::get<I>(columns_)[key]...);
+    }
+
+    template <std::size_t... I> void grow_columns(size_type new_capacity, std::index_sequence<I...>)
+    {
+        (grow_column<I>(new_capacity), ...);
+    }
+
+    template <std::size_t I> void grow_column(size_type new_capacity)
+    {
+        using value_type = column_type<I>;
+        auto allocator = replay::aligned_allocator<value_type>();
+        auto& buffer = std::get<I>(columns_);
+
+        if constexpr (std::is_trivially_copyable<value_type>::value)
+        {
+            buffer = allocator.reallocate(buffer, capacity_, new_capacity);
+        }
+        else
+        {
+            auto new_buffer = allocator.allocate(new_capacity);
+            for_each_initialized([&](size_type key) {
+                new (new_buffer + key) value_type(std::move(buffer[key]));
+                buffer[key].~value_type();
+            });
+
+            if (buffer != nullptr)
+                allocator.deallocate(buffer, capacity_);
+            buffer = new_buffer;
+        }
+    }
+
+    template <std::size_t... I> void free_columns(std::index_sequence<I...>)
+    {
+        ((std::get<I>(columns_) != nullptr
+              ? replay::aligned_allocator<column_type<I>>().deallocate(std::get<I>(columns_), capacity_)
+              : void()),
+         ...);
+    }
+
+    void free_memory()
+    {
+        free_columns(std::index_sequence_for<Ts...>{});
+        delete[] mask_;
+    }
+
+    void null_out()
+    {
+        size_ = 0;
+        capacity_ = 0;
+        smallest_key_bound_ = 0;
+        columns_ = columns_type{};
+        mask_ = nullptr;
+    }
+
+    void check_contains(key_type key) const
+    {
+        if (!contains(key))
+            throw std::out_of_range("Element not inserted");
+    }
+
+    void mark_inserted(key_type key)
+    {
+        ++size_;
+        mask_[key / bits_per_mask] |= mask_element_type{ 1 } << (key % bits_per_mask);
+        if (key >= smallest_key_bound_)
+            smallest_key_bound_ = key + 1;
+    }
+
+    bool element_initialized(size_type index) const
+    {
+        return mask_[index / bits_per_mask] & (mask_element_type{ 1 } << (index % bits_per_mask));
+    }
+
+    void size_to_include(size_type key)
+    {
+        // Exponentially grow the buffers
+        reserve(detail::capacity_to_include(capacity_, key));
+    }
+
+    size_type next_initialized(size_type key) const
+    {
+        if (key >= smallest_key_bound_)
+            return key;
+
+        return detail::next_set_bit(mask_, key, smallest_key_bound_);
+    }
+
+    template <class Function> void for_each_initialized(Function function) const
+    {
+        detail::for_each_set_bit(mask_, 0, smallest_key_bound_, function);
+    }
+
+    size_type size_ = 0;
+    size_type capacity_ = 0;
+    size_type smallest_key_bound_ = 0;
+
+    columns_type columns_{};
+    mask_element_type* mask_ = nullptr;
+};
+
+} // namespace replay
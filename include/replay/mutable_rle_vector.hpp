@@ -0,0 +1,176 @@
+#pragma once
+
+#include <iterator>
+#include <map>
+#include <replay/rle_vector.hpp>
+#include <stdexcept>
+
+namespace replay
+{
+
+/** Run-length encoded sequence that supports changing elements in place.
+    Runs are kept in a balanced tree keyed by their first position, so point and range assignments split and re-merge
+    runs in O(log runs) plus the number of runs that are overwritten. Neighboring runs never have the same value.
+*/
+template <typename T> class mutable_rle_vector
+{
+public:
+    using size_type = std::size_t;
+    using value_type = T;
+    using backing_container = std::map<size_type, T>;
+
+    mutable_rle_vector()
+    {
+        size_ = 0;
+    }
+
+    mutable_rle_vector(size_type count, T value)
+    : size_(0)
+    {
+        push(std::move(value), count);
+    }
+
+    explicit mutable_rle_vector(rle_vector<T> const& rhs)
+    : size_(0)
+    {
+        for (auto i = rhs.begin(), ie = rhs.end(); i != ie; i += i.repetition_count())
+            push(*i, i.repetition_count());
+    }
+
+    /** Append a run at the end, merging it into the last run if the values are equal.
+     */
+    void push(T value, size_type count = 1)
+    {
+        if (count == 0)
+        {
+            throw std::invalid_argument("Cannot add element without repetitions");
+        }
+
+        if (runs_.empty() || !(std::prev(runs_.end())->second == value))
+            runs_.emplace_hint(runs_.end(), size_, std::move(value));
+        size_ += count;
+    }
+
+    /** Set a single element.
+     */
+    void set(size_type index, T value)
+    {
+        assign_range(index, 1, std::move(value));
+    }
+
+    /** Set count consecutive elements starting at first to value.
+     */
+    void assign_range(size_type first, size_type count, T value)
+    {
+        if (first > size_ || count > size_ - first)
+        {
+            throw std::out_of_range("Range exceeds the vector");
+        }
+
+        if (count == 0)
+            return;
+
+        auto const last = first + count;
+
+        // Make sure runs start exactly at both ends of the range. Split the end first so the iterator to the start
+        // stays valid.
+        auto end = split_at(last);
+        auto begin = split_at(first);
+
+        begin->second = std::move(value);
+        runs_.erase(std::next(begin), end);
+
+        // Re-merge with the neighbors
+        if (end != runs_.end() && end->second == begin->second)
+            runs_.erase(end);
+
+        if (begin != runs_.begin() && std::prev(begin)->second == begin->second)
+            runs_.erase(begin);
+    }
+
+    /** Access an element in O(log runs).
+     */
+    T const& operator[](size_type index) const
+    {
+        return std::prev(runs_.upper_bound(index))->second;
+    }
+
+    T const& at(size_type index) const
+    {
+        if (index >= size_)
+            throw std::out_of_range("Position out of range");
+
+        return (*this)[index];
+    }
+
+    size_type size() const
+    {
+        return size_;
+    }
+
+    bool empty() const
+    {
+        return size_ == 0;
+    }
+
+    size_type run_count() const
+    {
+        return runs_.size();
+    }
+
+    /** Call function(first, count, value) for each run in order.
+     */
+    template <class Function> void for_each_run(Function&& function) const
+    {
+        for (auto i = runs_.begin(), ie = runs_.end(); i != ie;)
+        {
+            auto const next = std::next(i);
+            auto const run_end = next == ie ? size_ : next->first;
+            function(i->first, run_end - i->first, i->second);
+            i = next;
+        }
+    }
+
+    /** Copy the runs into an append-only \ref rle_vector.
+     */
+    rle_vector<T> to_rle_vector() const
+    {
+        rle_vector<T> result;
+        for_each_run([&](size_type, size_type count, T const& value) { result.push(value, count); });
+        return result;
+    }
+
+    bool operator==(mutable_rle_vector const& rhs) const
+    {
+        return size_ == rhs.size_ && runs_ == rhs.runs_;
+    }
+
+    bool operator!=(mutable_rle_vector const& rhs) const
+    {
+        return !(*this == rhs);
+    }
+
+private:
+    using run_iterator = typename backing_container::iterator;
+
+    /** Make sure a run starts at index, splitting the run that contains it if necessary.
+        \returns the run starting at index, or the end of the runs if index is the size.
+     */
+    run_iterator split_at(size_type index)
+    {
+        if (index == size_)
+            return runs_.end();
+
+        auto const after = runs_.upper_bound(index);
+        auto const containing = std::prev(after);
+        if (containing->first == index)
+            return containing;
+
+        return runs_.emplace_hint(after, index, containing->second);
+    }
+
+    backing_container runs_;
+    size_type size_;
+};
+
+} // namespace replay
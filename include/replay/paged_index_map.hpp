@@ -0,0 +1,595 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <new>
+#include <replay/mask_scan.hpp>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace replay
+{
+
+/** Sparse variant of \ref index_map for huge key spaces.
+    The key space is split into fixed-size pages that are allocated when the first key in them is inserted and
+    freed when the last one is erased. The page directory is a balanced tree that only holds occupied pages, so memory
+    use is proportional to the number of occupied pages, regardless of how large the keys are. Finding a page costs
+    O(log pages).
+    Interface and iteration order are the same as for \ref index_map.
+    \tparam PageSize Number of keys per page, must be a positive multiple of 64.
+    \tparam CopyOnWrite Share pages between copies and clone them on the first write. Copying the map then only
+    costs a reference per page, which makes it cheap to take snapshots. Note that mutable access, including
+    iterating a non-const map, counts as a write.
+    \see cow_index_map
+*/
+template <class T, std::size_t PageSize = 4096, bool CopyOnWrite = false> class paged_index_map
+{
+public:
+    using size_type = std::size_t;
+    using key_type = size_type;
+    using mapped_type = T;
+    using value_type = std::pair<const key_type, mapped_type>;
+    using mask_element_type = std::uint64_t;
+
+    enum
+    {
+        bits_per_mask = sizeof(mask_element_type) * 8 / sizeof(std::uint8_t),
+        page_size = PageSize,
+        words_per_page = PageSize / bits_per_mask,
+    };
+
+    static_assert(PageSize > 0 && PageSize % bits_per_mask == 0, "Page size must be a multiple of the mask size");
+
+private:
+    struct page;
+    using page_pointer = std::conditional_t<CopyOnWrite, std::shared_ptr<page>, std::unique_ptr<page>>;
+
+public:
+
+    template <bool Const> class base_iterator
+    {
+    public:
+        using value_type =
+            std::conditional_t<Const, std::add_const_t<paged_index_map::mapped_type>, paged_index_map::mapped_type>;
+        using reference = value_type&;
+        using pointer = value_type*;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::bidirectional_iterator_tag;
+
+        using container_type = std::conditional_t<Const, std::add_const_t<paged_index_map>, paged_index_map>;
+
+        base_iterator(container_type* parent, size_type index)
+        : parent_(parent)
+        , index_(parent->next_initialized(index))
+        {
+        }
+
+        base_iterator& operator++()
+        {
+            index_ = parent_->next_initialized(index_ + 1);
+            return *this;
+        }
+
+        base_iterator operator++(int)
+        {
+            auto result = *this;
+            ++(*this);
+            return result;
+        }
+
+        base_iterator& operator--()
+        {
+            index_ = parent_->previous_initialized(index_ - 1);
+            return *this;
+        }
+
+        base_iterator operator--(int)
+        {
+            auto result = *this;
+            --(*this);
+            return result;
+        }
+
+        reference operator*() const
+        {
+            return (*parent_)[index_];
+        }
+
+        pointer operator->() const
+        {
+            return &((*parent_)[index_]);
+        }
+
+        size_type key() const
+        {
+            return index_;
+        }
+
+        template <bool OtherConst> bool operator==(base_iterator<OtherConst> const& rhs) const
+        {
+            return index_ == rhs.key();
+        }
+
+        template <bool OtherConst> bool operator!=(base_iterator<OtherConst> const& rhs) const
+        {
+            return index_ != rhs.key();
+        }
+
+        template <bool OtherConst> bool operator<(base_iterator<OtherConst> const& rhs) const
+        {
+            return index_ < rhs.key();
+        }
+
+        template <bool OtherConst> bool operator>(base_iterator<OtherConst> const& rhs) const
+        {
+            return index_ > rhs.key();
+        }
+
+        template <bool OtherConst> bool operator<=(base_iterator<OtherConst> const& rhs) const
+        {
+            return index_ <= rhs.key();
+        }
+
+        template <bool OtherConst> bool operator>=(base_iterator<OtherConst> const& rhs) const
+        {
+            return index_ >= rhs.key();
+        }
+
+    private:
+        container_type* parent_;
+        size_type index_;
+    };
+
+    using iterator = base_iterator<false>;
+    using const_iterator = base_iterator<true>;
+
+    paged_index_map() = default;
+
+    paged_index_map(paged_index_map const& rhs)
+    : size_(rhs.size_)
+    , smallest_key_bound_(rhs.smallest_key_bound_)
+    {
+        if constexpr (CopyOnWrite)
+        {
+            pages_ = rhs.pages_;
+        }
+        else
+        {
+            for (auto const& each : rhs.pages_)
+                pages_.emplace_hint(pages_.end(), each.first, std::make_unique<page>(*each.second));
+        }
+    }
+
+    paged_index_map(paged_index_map&& rhs) noexcept
+    : pages_(std::move(rhs.pages_))
+    , size_(rhs.size_)
+    , smallest_key_bound_(rhs.smallest_key_bound_)
+    {
+        rhs.pages_.clear();
+        rhs.size_ = 0;
+        rhs.smallest_key_bound_ = 0;
+    }
+
+    paged_index_map& operator=(paged_index_map const& rhs)
+    {
+        *this = paged_index_map(rhs); // copy-construct and move
+        return *this;
+    }
+
+    paged_index_map& operator=(paged_index_map&& rhs) noexcept
+    {
+        if (&rhs == this)
+            return *this;
+
+        pages_ = std::move(rhs.pages_);
+        size_ = rhs.size_;
+        smallest_key_bound_ = rhs.smallest_key_bound_;
+
+        rhs.pages_.clear();
+        rhs.size_ = 0;
+        rhs.smallest_key_bound_ = 0;
+        return *this;
+    }
+
+    bool empty() const
+    {
+        return size_ == 0;
+    }
+
+    size_type size() const
+    {
+        return size_;
+    }
+
+    /** Number of pages that are currently shared with copies of this map.
+     */
+    size_type shared_page_count() const
+    {
+        if constexpr (CopyOnWrite)
+        {
+            return static_cast<size_type>(std::count_if(
+                pages_.begin(), pages_.end(), [](auto const& each) { return each.second.use_count() > 1; }));
+        }
+        else
+        {
+            return 0;
+        }
+    }
+
+    /** Number of pages that are currently allocated.
+     */
+    size_type allocated_page_count() const
+    {
+        return pages_.size();
+    }
+
+    void erase(key_type key)
+    {
+        if (!contains(key))
+            return;
+
+        auto const page_index = key / PageSize;
+        if (find_page(page_index)->count == 1)
+        {
+            // The page would end up empty, so drop it without cloning it first
+            release_page(page_index);
+        }
+        else
+        {
+            writable_page(page_index).destroy(key % PageSize);
+        }
+        --size_;
+
+        if ((key + 1) == smallest_key_bound_)
+        {
+            auto const last = previous_initialized(key);
+            smallest_key_bound_ = contains(last) ? last + 1 : 0;
+        }
+    }
+
+    void erase(iterator it)
+    {
+        erase(it.key());
+    }
+
+    void erase(const_iterator it)
+    {
+        erase(it.key());
+    }
+
+    void insert(value_type&& value)
+    {
+        insert(value.first, std::move(value.second));
+    }
+
+    void insert(value_type const& value)
+    {
+        insert(value.first, value.second);
+    }
+
+    /** Insert or update an value.
+     */
+    template <class InitializerType> void upsert(key_type const& key, InitializerType&& value)
+    {
+        auto& p = page_to_include(key);
+        auto const offset = key % PageSize;
+        if (p.initialized(offset))
+        {
+            p.values()[offset] = std::forward<InitializerType>(value);
+            return;
+        }
+
+        emplace_new(p, key, std::forward<InitializerType>(value));
+    }
+
+    template <class InitializerType> void insert(key_type const& key, InitializerType&& value)
+    {
+        // Check before unsharing, so that inserting an existing key does not clone its page
+        if (contains(key))
+            return;
+
+        emplace_new(page_to_include(key), key, std::forward<InitializerType>(value));
+    }
+
+    mapped_type& operator[](key_type key)
+    {
+        return writable_page(key / PageSize).values()[key % PageSize];
+    }
+
+    mapped_type const& operator[](key_type key) const
+    {
+        return find_page(key / PageSize)->values()[key % PageSize];
+    }
+
+    mapped_type& at(key_type key)
+    {
+        // Not forwarded to the const version, since this has to unshare the page
+        if (!contains(key))
+            throw std::out_of_range("Element not inserted");
+        return (*this)[key];
+    }
+
+    mapped_type const& at(key_type key) const
+    {
+        if (!contains(key))
+            throw std::out_of_range("Element not inserted");
+        return (*this)[key];
+    }
+
+    bool contains(key_type key) const
+    {
+        auto const p = find_page(key / PageSize);
+        return p != nullptr && p->initialized(key % PageSize);
+    }
+
+    iterator begin()
+    {
+        return iterator(this, 0);
+    }
+
+    iterator end()
+    {
+        return iterator(this, smallest_key_bound_);
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(this, smallest_key_bound_);
+    }
+
+    bool operator==(paged_index_map const& rhs) const
+    {
+        if (size_ != rhs.size_ || smallest_key_bound_ != rhs.smallest_key_bound_)
+            return false;
+
+        // Empty pages are always released, so equal maps have the same directory
+        if (pages_.size() != rhs.pages_.size())
+            return false;
+
+        for (auto lhs_entry = pages_.begin(), rhs_entry = rhs.pages_.begin(); lhs_entry != pages_.end();
+             ++lhs_entry, ++rhs_entry)
+        {
+            if (lhs_entry->first != rhs_entry->first)
+                return false;
+
+            auto const& lhs_page = lhs_entry->second;
+            auto const& rhs_page = rhs_entry->second;
+            if (lhs_page == rhs_page)
+                continue;
+
+            if (!std::equal(lhs_page->mask, lhs_page->mask + words_per_page, rhs_page->mask))
+                return false;
+
+            bool equal = true;
+            lhs_page->for_each_initialized(
+                [&](size_type offset) { equal = equal && lhs_page->values()[offset] == rhs_page->values()[offset]; });
+            if (!equal)
+                return false;
+        }
+
+        return true;
+    }
+
+    bool operator!=(paged_index_map const& rhs) const
+    {
+        return !(*this == rhs);
+    }
+
+    /** Erase all elements and free all pages.
+     */
+    void clear()
+    {
+        pages_.clear();
+        size_ = 0;
+        smallest_key_bound_ = 0;
+    }
+
+    template <typename BinaryPredicate> size_type remove_if(BinaryPredicate p)
+    {
+        size_type removal_count = 0;
+
+        // Erasing might release pages, so do not hold on to directory iterators
+        std::vector<size_type> page_indices;
+        page_indices.reserve(pages_.size());
+        for (auto const& each : pages_)
+            page_indices.push_back(each.first);
+
+        for (auto i : page_indices)
+        {
+            // Only read here, since erasing might clone or release the page
+            page const& current = *find_page(i);
+            auto const first_key = i * PageSize;
+            std::vector<size_type> doomed;
+            current.for_each_initialized([&](size_type offset) {
+                if (p(first_key + offset, current.values()[offset]))
+                    doomed.push_back(first_key + offset);
+            });
+
+            for (auto key : doomed)
+                erase(key);
+            removal_count += doomed.size();
+        }
+        return removal_count;
+    }
+
+    /** The smallest number so that all keys are smaller than this.
+    */
+    size_type smallest_key_bound() const
+    {
+        return smallest_key_bound_;
+    }
+
+private:
+    struct page
+    {
+        page() = default;
+
+        page(page const& rhs)
+        {
+            rhs.for_each_initialized(
+                [&](size_type offset) { new (values() + offset) mapped_type(rhs.values()[offset]); });
+            std::copy(rhs.mask, rhs.mask + words_per_page, mask);
+            count = rhs.count;
+        }
+
+        page& operator=(page const&) = delete;
+
+        ~page()
+        {
+            for_each_initialized([this](size_type offset) { values()[offset].~mapped_type(); });
+        }
+
+        mapped_type* values()
+        {
+            return std::launder(reinterpret_cast<mapped_type*>(storage));
+        }
+
+        mapped_type const* values() const
+        {
+            return std::launder(reinterpret_cast<mapped_type const*>(storage));
+        }
+
+        bool initialized(size_type offset) const
+        {
+            return mask[offset / bits_per_mask] & (mask_element_type{ 1 } << (offset % bits_per_mask));
+        }
+
+        void mark(size_type offset)
+        {
+            mask[offset / bits_per_mask] |= mask_element_type{ 1 } << (offset % bits_per_mask);
+            ++count;
+        }
+
+        void destroy(size_type offset)
+        {
+            values()[offset].~mapped_type();
+            mask[offset / bits_per_mask] &= ~(mask_element_type{ 1 } << (offset % bits_per_mask));
+            --count;
+        }
+
+        template <class Function> void for_each_initialized(Function function) const
+        {
+            detail::for_each_set_bit(mask, 0, PageSize, function);
+        }
+
+        mask_element_type mask[words_per_page] = {};
+        size_type count = 0;
+        alignas(mapped_type) unsigned char storage[sizeof(mapped_type) * PageSize];
+    };
+
+    page const* find_page(size_type page_index) const
+    {
+        auto const found = pages_.find(page_index);
+        return found == pages_.end() ? nullptr : found->second.get();
+    }
+
+    page& page_to_include(key_type key)
+    {
+        auto const page_index = key / PageSize;
+        auto& result = pages_[page_index];
+        if (!result)
+        {
+            if constexpr (CopyOnWrite)
+                result = std::make_shared<page>();
+            else
+                result = std::make_unique<page>();
+            return *result;
+        }
+        return writable_page(page_index);
+    }
+
+    /** Get an existing page for modification, cloning it first if it is shared with a copy.
+     */
+    page& writable_page(size_type page_index)
+    {
+        auto& result = pages_.find(page_index)->second;
+        if constexpr (CopyOnWrite)
+        {
+            if (result.use_count() > 1)
+                result = std::make_shared<page>(static_cast<page const&>(*result));
+        }
+        return *result;
+    }
+
+    template <class InitializerType> void emplace_new(page& p, key_type key, InitializerType&& value)
+    {
+        auto const offset = key % PageSize;
+        try
+        {
+            new (p.values() + offset) mapped_type(std::forward<InitializerType>(value));
+        }
+        catch (...)
+        {
+            // Do not keep a page that was only created for this value
+            if (p.count == 0)
+                release_page(key / PageSize);
+            throw;
+        }
+        p.mark(offset);
+        ++size_;
+
+        if (key >= smallest_key_bound_)
+            smallest_key_bound_ = key + 1;
+    }
+
+    void release_page(size_type page_index)
+    {
+        pages_.erase(page_index);
+    }
+
+    /** The smallest initialized key that is not smaller than the given key, or the smallest key bound.
+        Keys that are already past the bound are returned unchanged. Skips missing pages and empty mask words.
+     */
+    size_type next_initialized(size_type key) const
+    {
+        if (key >= smallest_key_bound_)
+            return key;
+
+        for (auto entry = pages_.lower_bound(key / PageSize); entry != pages_.end(); ++entry)
+        {
+            auto const first_key = entry->first * PageSize;
+            auto const first_offset = key > first_key ? key - first_key : 0;
+            auto const offset = detail::next_set_bit(entry->second->mask, first_offset, PageSize);
+            if (offset != PageSize)
+                return first_key + offset;
+        }
+        return smallest_key_bound_;
+    }
+
+    /** The largest initialized key that is not larger than the given key, or 0 if there is none.
+     */
+    size_type previous_initialized(size_type key) const
+    {
+        for (auto entry = pages_.upper_bound(key / PageSize); entry != pages_.begin();)
+        {
+            --entry;
+            auto const first_key = entry->first * PageSize;
+            auto const last_offset = std::min(key - first_key + 1, size_type{ PageSize });
+            auto const bound = detail::set_bits_bound(entry->second->mask, last_offset);
+            if (bound != 0)
+                return first_key + bound - 1;
+        }
+        return 0;
+    }
+
+    std::map<size_type, page_pointer> pages_;
+    size_type size_ = 0;
+    size_type smallest_key_bound_ = 0;
+};
+
+/** Paged index map with copy-on-write pages, for cheap snapshots.
+    A copy costs O(pages), and a write to a shared page clones only that page.
+*/
+template <class T, std::size_t PageSize = 4096> using cow_index_map = paged_index_map<T, PageSize, true>;
+
+} // namespace replay
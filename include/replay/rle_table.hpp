@@ -0,0 +1,205 @@
+#pragma once
+
+#include <replay/rle_vector.hpp>
+#include <replay/table.hpp>
+#include <stdexcept>
+#include <vector>
+
+namespace replay
+{
+
+/** Two dimensional grid that run-length encodes each row.
+    Intended for large and mostly uniform grids, where it needs a fraction of the memory of a dense \ref table.
+    Element access is O(log runs) in the row, scanning a row is linear in its runs.
+    \see table
+*/
+template <class T> class rle_table
+{
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using row_type = rle_vector<T>;
+
+    /** Default constructor. Creates an empty table.
+     */
+    rle_table() = default;
+
+    /** Construct a table of given width and height filled with a value.
+     */
+    rle_table(size_type w, size_type h, value_type const& value)
+    : rows_(w ? h : 0, row_type(w, value))
+    , width_(h ? w : 0)
+    {
+    }
+
+    /** Compress a dense table.
+     */
+    explicit rle_table(table<T> const& rhs)
+    : width_(rhs.width())
+    {
+        rows_.reserve(rhs.height());
+        for (size_type y = 0; y < rhs.height(); ++y)
+            rows_.push_back(row_type::encode(rhs.ptr() + rhs.element_offset(0, y), width_));
+    }
+
+    /** Decompress into a dense table.
+     */
+    table<T> to_table() const
+    {
+        table<T> result(width(), height());
+        for (size_type y = 0; y < height(); ++y)
+            rows_[y].expand_into(result.ptr() + result.element_offset(0, y), width_);
+        return result;
+    }
+
+    /** Access an element.
+        \param x The column in the table.
+        \param y The row in the table.
+    */
+    value_type const& operator()(size_type x, size_type y) const
+    {
+        return rows_[y][x];
+    }
+
+    /** Access a row for scanning its runs.
+     */
+    row_type const& row(size_type y) const
+    {
+        return rows_[y];
+    }
+
+    /** Set a single element.
+     */
+    void set(size_type x, size_type y, value_type const& value)
+    {
+        fill_rect(x, y, 1, 1, value);
+    }
+
+    /** Set all elements in a rectangle to a value. The rectangle has to be inside the table.
+        Only the affected rows are re-encoded.
+    */
+    void fill_rect(size_type x, size_type y, size_type w, size_type h, value_type const& value)
+    {
+        if (x > width_ || w > width_ - x || y > height() || h > height() - y)
+        {
+            throw std::out_of_range("Rectangle exceeds the table");
+        }
+
+        if (w == 0)
+            return;
+
+        // Copy, since the value might refer into a row that is replaced
+        auto const copy = value;
+        for (size_type row_index = y; row_index < y + h; ++row_index)
+            rows_[row_index] = overwritten(rows_[row_index], x, w, copy);
+    }
+
+    /** Set all elements to a value.
+     */
+    void fill(value_type const& value)
+    {
+        auto const row = row_type(width_, value);
+        for (auto& each : rows_)
+            each = row;
+    }
+
+    /** Get the width of the table, i.e. the number of columns.
+     */
+    size_type width() const
+    {
+        return width_;
+    }
+
+    /** Get the height of the table, i.e. the number of rows.
+     */
+    size_type height() const
+    {
+        return rows_.size();
+    }
+
+    /** Checks whether the table is empty.
+     */
+    bool empty() const
+    {
+        return rows_.empty();
+    }
+
+    /** Total number of runs in all rows. This is proportional to the memory used.
+     */
+    size_type run_count() const
+    {
+        size_type result = 0;
+        for (auto const& each : rows_)
+        {
+            for (auto i = each.begin(), ie = each.end(); i != ie; i += i.repetition_count())
+                ++result;
+        }
+        return result;
+    }
+
+    bool operator==(rle_table const& rhs) const
+    {
+        return width_ == rhs.width_ && rows_ == rhs.rows_;
+    }
+
+    bool operator!=(rle_table const& rhs) const
+    {
+        return !(*this == rhs);
+    }
+
+private:
+    /** Copy of a row with count elements starting at first replaced by value.
+     */
+    static row_type overwritten(row_type const& row, size_type first, size_type count, value_type const& value)
+    {
+        row_type result;
+        value_type const* pending = nullptr;
+        size_type pending_count = 0;
+
+        // Merges neighboring runs with equal values
+        auto emit = [&](value_type const& each, size_type each_count) {
+            if (pending && *pending == each)
+            {
+                pending_count += each_count;
+                return;
+            }
+            if (pending)
+                result.push(*pending, pending_count);
+            pending = &each;
+            pending_count = each_count;
+        };
+
+        auto const last = first + count;
+        size_type run_start = 0;
+        bool inserted = false;
+        for (auto i = row.begin(), ie = row.end(); i != ie;)
+        {
+            auto const run_count = i.repetition_count();
+            auto const run_end = run_start + run_count;
+
+            if (run_start < first)
+                emit(*i, std::min(run_end, first) - run_start);
+
+            if (!inserted && run_end > first)
+            {
+                emit(value, count);
+                inserted = true;
+            }
+
+            if (run_end > last)
+                emit(*i, run_end - std::max(run_start, last));
+
+            run_start = run_end;
+            i += run_count;
+        }
+
+        if (pending)
+            result.push(*pending, pending_count);
+        return result;
+    }
+
+    std::vector<row_type> rows_;
+    size_type width_ = 0;
+};
+
+} // namespace replay
@@ -1,10 +1,89 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <replay/bits.hpp>
 #include <stdexcept>
+#include <type_traits>
 #include <vector>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#define REPLAY_RLE_SSE2 1
+#endif
+
 namespace replay
 {
+namespace detail
+{
+
+/** Whether runs of T can be found by comparing raw bytes in SIMD registers.
+    This assumes that equality of types without padding or multiple representations is bitwise equality.
+ */
+template <class T>
+constexpr bool rle_bitwise_comparable = std::is_trivially_copyable<T>::value &&
+                                        std::has_unique_object_representations<T>::value &&
+                                        (sizeof(T) == 1 || sizeof(T) == 4);
+
+#if defined(REPLAY_RLE_SSE2)
+template <class T> std::uint32_t rle_pattern(T const& value)
+{
+    if constexpr (sizeof(T) == 1)
+    {
+        std::uint8_t byte;
+        std::memcpy(&byte, &value, 1);
+        return byte * 0x01010101u;
+    }
+    else
+    {
+        std::uint32_t word;
+        std::memcpy(&word, &value, 4);
+        return word;
+    }
+}
+#endif
+
+/** Number of leading elements that are equal to the first. count must not be zero.
+ */
+template <class T> std::size_t rle_run_length(T const* values, std::size_t count)
+{
+    std::size_t result = 1;
+#if defined(REPLAY_RLE_SSE2)
+    if constexpr (rle_bitwise_comparable<T>)
+    {
+        auto const pattern = static_cast<int>(rle_pattern(values[0]));
+        auto const bytes = reinterpret_cast<char const*>(values);
+        auto const byte_count = count * sizeof(T);
+        std::size_t offset = 0;
+#if defined(__AVX2__)
+        auto const wide_pattern = _mm256_set1_epi32(pattern);
+        for (; offset + 32 <= byte_count; offset += 32)
+        {
+            auto const block = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(bytes + offset));
+            auto const equal = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, wide_pattern)));
+            if (equal != 0xFFFFFFFFu)
+                return (offset + count_trailing_zeros(~equal)) / sizeof(T);
+        }
+#endif
+        auto const narrow_pattern = _mm_set1_epi32(pattern);
+        for (; offset + 16 <= byte_count; offset += 16)
+        {
+            auto const block = _mm_loadu_si128(reinterpret_cast<__m128i const*>(bytes + offset));
+            auto const equal = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, narrow_pattern)));
+            if (equal != 0xFFFFu)
+                return (offset + count_trailing_zeros(~equal & 0xFFFFu)) / sizeof(T);
+        }
+        result = std::max<std::size_t>(offset / sizeof(T), 1);
+    }
+#endif
+    while (result < count && values[result] == values[0])
+        ++result;
+    return result;
+}
+
+} // namespace detail
 
 template <typename T> class rle_vector
 {
@@ -22,10 +101,13 @@ public:
         using reference = value_type const&;
         using pointer = value_type const*;
         using difference_type = std::ptrdiff_t;
-        using iterator_category = std::forward_iterator_tag;
+        using iterator_category = std::random_access_iterator_tag;
+
+        iterator() = default;
 
-        iterator(backing_iterator backing, size_type index)
-        : backing_(backing)
+        iterator(rle_vector const* parent, backing_iterator backing, size_type index)
+        : parent_(parent)
+        , backing_(backing)
         , index_(index)
         {
         }
@@ -40,6 +122,26 @@ public:
             return backing_ != rhs.backing_ || index_ != rhs.index_;
         }
 
+        bool operator<(iterator const& rhs) const
+        {
+            return backing_ < rhs.backing_ || (backing_ == rhs.backing_ && index_ < rhs.index_);
+        }
+
+        bool operator>(iterator const& rhs) const
+        {
+            return rhs < *this;
+        }
+
+        bool operator<=(iterator const& rhs) const
+        {
+            return !(rhs < *this);
+        }
+
+        bool operator>=(iterator const& rhs) const
+        {
+            return !(*this < rhs);
+        }
+
         iterator& operator++()
         {
             ++index_;
@@ -58,18 +160,45 @@ public:
             return result;
         }
 
-        iterator& operator+=(size_type rhs)
+        iterator& operator--()
         {
-            auto new_index = index_ + rhs;
-            while (new_index > 0 && new_index >= backing_->second)
+            if (index_ == 0)
             {
-                new_index -= backing_->second;
-                ++backing_;
+                --backing_;
+                index_ = backing_->second;
             }
-            index_ = new_index;
+            --index_;
             return *this;
         }
 
+        iterator const operator--(int)
+        {
+            auto result = *this;
+            --(*this);
+            return result;
+        }
+
+        /** Advance by a number of elements.
+            Stays in the current run if possible, otherwise uses a binary search over the runs.
+         */
+        iterator& operator+=(difference_type rhs)
+        {
+            auto const new_index = static_cast<difference_type>(index_) + rhs;
+            if (new_index >= 0 && backing_ != parent_->values_.end() &&
+                static_cast<size_type>(new_index) < backing_->second)
+            {
+                index_ = static_cast<size_type>(new_index);
+                return *this;
+            }
+
+            return *this = parent_->lower_bound(static_cast<size_type>(position() + rhs));
+        }
+
+        iterator& operator-=(difference_type rhs)
+        {
+            return *this += -rhs;
+        }
+
         reference operator*() const
         {
             return backing_->first;
@@ -80,19 +209,47 @@ public:
             return &backing_->first;
         }
 
+        reference operator[](difference_type rhs) const
+        {
+            return *(*this + rhs);
+        }
+
         size_type repetition_count() const
         {
             return backing_->second - index_;
         }
 
-        iterator operator+(size_type rhs) const
+        iterator operator+(difference_type rhs) const
         {
             auto result = *this;
             return result += rhs;
         }
+
+        friend iterator operator+(difference_type lhs, iterator const& rhs)
+        {
+            return rhs + lhs;
+        }
+
+        iterator operator-(difference_type rhs) const
+        {
+            auto result = *this;
+            return result -= rhs;
+        }
+
+        difference_type operator-(iterator const& rhs) const
+        {
+            return static_cast<difference_type>(position()) - static_cast<difference_type>(rhs.position());
+        }
+
     private:
+        size_type position() const
+        {
+            return parent_->run_start(backing_ - parent_->values_.begin()) + index_;
+        }
+
+        rle_vector const* parent_ = nullptr;
         backing_iterator backing_;
-        size_type index_;
+        size_type index_ = 0;
     };
 
     rle_vector()
@@ -102,6 +259,7 @@ public:
 
     rle_vector(size_type count, T value)
     : values_(1, std::make_pair(value, count))
+    , ends_(1, count)
     , size_(count)
     {
     }
@@ -110,8 +268,12 @@ public:
     : values_(list)
     , size_(0)
     {
+        ends_.reserve(values_.size());
         for (auto const& each : values_)
+        {
             size_ += each.second;
+            ends_.push_back(size_);
+        }
     }
 
     void push(T value, size_type count = 1)
@@ -123,16 +285,90 @@ public:
 
         values_.push_back(std::make_pair(value, count));
         size_ += count;
+        ends_.push_back(size_);
+    }
+
+    /** Run-length encode a contiguous array of values.
+        Bytes and other 4-byte types without padding, such as \ref byte_rgba, find run boundaries using SIMD compares.
+     */
+    static rle_vector encode(T const* values, size_type count)
+    {
+        rle_vector result;
+        result.append(values, count);
+        return result;
+    }
+
+    /** Run-length encode a contiguous array of values and append them.
+        Unlike \ref push, this extends the last run if it has the same value as the first new element.
+     */
+    void append(T const* values, size_type count)
+    {
+        size_type offset = 0;
+        if (count > 0 && !values_.empty() && values_.back().first == values[0])
+        {
+            offset = detail::rle_run_length(values, count);
+            values_.back().second += offset;
+            size_ += offset;
+            ends_.back() = size_;
+        }
+
+        while (offset < count)
+        {
+            auto const length = detail::rle_run_length(values + offset, count - offset);
+            push(values[offset], length);
+            offset += length;
+        }
+    }
+
+    /** Decode all elements into a contiguous array.
+        \param output Array to write the elements to.
+        \param count Size of the output array, must be at least \ref size().
+     */
+    void expand_into(T* output, size_type count) const
+    {
+        if (count < size_)
+        {
+            throw std::invalid_argument("Output is too small to expand into");
+        }
+
+        for (auto const& run : values_)
+            output = std::fill_n(output, run.second, run.first);
     }
 
     iterator begin() const
     {
-        return iterator(values_.begin(), 0);
+        return iterator(this, values_.begin(), 0);
     }
 
     iterator end() const
     {
-        return iterator(values_.end(), 0);
+        return iterator(this, values_.end(), 0);
+    }
+
+    /** Find the element at a logical position in O(log runs).
+        \returns an iterator to the element, or end() if position is not smaller than size().
+     */
+    iterator lower_bound(size_type position) const
+    {
+        if (position >= size_)
+            return end();
+
+        // First run that ends after position
+        auto const run = std::upper_bound(ends_.begin(), ends_.end(), position) - ends_.begin();
+        return iterator(this, values_.begin() + run, position - run_start(run));
+    }
+
+    T const& operator[](size_type position) const
+    {
+        return *lower_bound(position);
+    }
+
+    T const& at(size_type position) const
+    {
+        if (position >= size_)
+            throw std::out_of_range("Position out of range");
+
+        return (*this)[position];
     }
 
     size_type size() const
@@ -161,7 +397,15 @@ public:
     }
 
 private:
+    size_type run_start(std::ptrdiff_t run) const
+    {
+        return run == 0 ? 0 : ends_[run - 1];
+    }
+
     backing_container values_;
+
+    // Logical end position of each run, i.e. the inclusive prefix sums of the repetitions
+    std::vector<size_type> ends_;
     size_type size_;
 };
 
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <replay/index_map.hpp>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace replay
+{
+
+/** Container that hands out its own keys and detects stale ones.
+    Keys are handles made up of a slot index and a generation counter. Erased slots are kept in an intrusive free
+    list and reused by later insertions, so the key space of the underlying \ref index_map stays bounded by the
+    peak number of elements. Every reuse bumps the slot's generation, so handles to erased elements are detected in
+    constant time.
+*/
+template <class T> class slot_map
+{
+public:
+    using size_type = std::size_t;
+    using mapped_type = T;
+    using index_type = std::uint32_t;
+    using generation_type = std::uint32_t;
+
+    struct handle
+    {
+        index_type index = 0;
+        generation_type generation = 0; // Valid generations start at 1, so a default handle is never valid
+
+        bool operator==(handle const& rhs) const
+        {
+            return index == rhs.index && generation == rhs.generation;
+        }
+
+        bool operator!=(handle const& rhs) const
+        {
+            return !(*this == rhs);
+        }
+    };
+
+    using iterator = typename index_map<T>::iterator;
+    using const_iterator = typename index_map<T>::const_iterator;
+
+    /** Insert a value and return a new handle to it.
+     */
+    template <class InitializerType> handle insert(InitializerType&& value)
+    {
+        // Only take the slot once the value is in place, so a throwing constructor does not lose it
+        auto const reuse = free_head_ != no_slot;
+        index_type index = free_head_;
+        if (!reuse)
+        {
+            if (slots_.size() == no_slot)
+                throw std::length_error("slot_map is out of slots");
+
+            index = static_cast<index_type>(slots_.size());
+            slots_.push_back(slot{});
+        }
+
+        try
+        {
+            values_.insert(index, std::forward<InitializerType>(value));
+        }
+        catch (...)
+        {
+            if (!reuse)
+                slots_.pop_back();
+            throw;
+        }
+
+        auto& slot = slots_[index];
+        if (reuse)
+            free_head_ = slot.next_free;
+        slot.next_free = no_slot;
+        return handle{ index, slot.generation };
+    }
+
+    /** Erase the element referred to by the handle.
+        \returns false if the handle is stale.
+     */
+    bool erase(handle h)
+    {
+        if (!contains(h))
+            return false;
+
+        values_.erase(h.index);
+
+        // Retire slots whose generation would wrap around, so old handles can never become valid again
+        auto& slot = slots_[h.index];
+        if (slot.generation == std::numeric_limits<generation_type>::max())
+            return true;
+
+        ++slot.generation;
+        slot.next_free = free_head_;
+        free_head_ = h.index;
+        return true;
+    }
+
+    /** Check whether the handle refers to a live element.
+     */
+    bool contains(handle h) const
+    {
+        return h.index < slots_.size() && slots_[h.index].generation == h.generation && values_.contains(h.index);
+    }
+
+    /** Get a pointer to the element, or nullptr if the handle is stale.
+     */
+    mapped_type* find(handle h)
+    {
+        return contains(h) ? &values_[h.index] : nullptr;
+    }
+
+    /** Get a pointer to the element, or nullptr if the handle is stale.
+     */
+    mapped_type const* find(handle h) const
+    {
+        return contains(h) ? &values_[h.index] : nullptr;
+    }
+
+    mapped_type& at(handle h)
+    {
+        return const_cast<mapped_type&>(const_cast<slot_map const&>(*this).at(h));
+    }
+
+    mapped_type const& at(handle h) const
+    {
+        if (!contains(h))
+            throw std::out_of_range("Stale slot_map handle");
+        return values_[h.index];
+    }
+
+    /** Access an element without checking the handle.
+     */
+    mapped_type& operator[](handle h)
+    {
+        return values_[h.index];
+    }
+
+    /** Access an element without checking the handle.
+     */
+    mapped_type const& operator[](handle h) const
+    {
+        return values_[h.index];
+    }
+
+    /** Build the current handle for an iterator.
+     */
+    handle handle_of(iterator const& i) const
+    {
+        return handle_of_key(i.key());
+    }
+
+    /** Build the current handle for an iterator.
+     */
+    handle handle_of(const_iterator const& i) const
+    {
+        return handle_of_key(i.key());
+    }
+
+    size_type size() const
+    {
+        return values_.size();
+    }
+
+    bool empty() const
+    {
+        return values_.empty();
+    }
+
+    /** Erase all elements. All outstanding handles become stale.
+     */
+    void clear()
+    {
+        for (auto i = values_.begin(), ie = values_.end(); i != ie; ++i)
+            erase(handle_of_key(i.key()));
+    }
+
+    iterator begin()
+    {
+        return values_.begin();
+    }
+
+    iterator end()
+    {
+        return values_.end();
+    }
+
+    const_iterator begin() const
+    {
+        return values_.begin();
+    }
+
+    const_iterator end() const
+    {
+        return values_.end();
+    }
+
+    /** The underlying storage, keyed by slot index.
+     */
+    index_map<T> const& values() const
+    {
+        return values_;
+    }
+
+private:
+    handle handle_of_key(size_type key) const
+    {
+        auto const index = static_cast<index_type>(key);
+        return handle{ index, slots_[index].generation };
+    }
+
+    static constexpr index_type no_slot = std::numeric_limits<index_type>::max();
+
+    struct slot
+    {
+        generation_type generation = 1;
+        index_type next_free = no_slot;
+    };
+
+    index_map<T> values_;
+    std::vector<slot> slots_;
+    index_type free_head_ = no_slot;
+};
+
+} // namespace replay
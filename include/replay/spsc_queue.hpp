@@ -0,0 +1,177 @@
+/*
+replay
+Software Library
+
+Copyright (c) 2010-2019 Marius Elvert
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <optional>
+#include <replay/aligned_allocator.hpp>
+#include <replay/common.hpp>
+#include <stdexcept>
+#include <thread>
+
+namespace replay
+{
+
+/** Bounded, lock-free single-producer, single-consumer queue.
+    This is a ring buffer with a power-of-two capacity. The producer only ever writes the tail index and the
+    consumer only ever writes the head index, so no locks are needed. Both indices live on their own cache line.
+    Use \ref concurrent_queue instead if the queue needs to grow without bounds.
+ */
+template <class T> class spsc_queue
+{
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using allocator_type = replay::aligned_allocator<value_type>;
+
+    /** Create a queue that can hold at least the given number of elements.
+        The capacity is rounded up to the next power of two.
+     */
+    explicit spsc_queue(size_type min_capacity)
+    : m_capacity(detail::round_up_to_power_of_two(min_capacity))
+    , m_mask(m_capacity - 1)
+    , m_buffer(allocator_type().allocate(m_capacity))
+    {
+    }
+
+    spsc_queue(spsc_queue const&) = delete;
+    spsc_queue& operator=(spsc_queue const&) = delete;
+
+    ~spsc_queue()
+    {
+        auto const tail = m_tail.load(std::memory_order_relaxed);
+        for (auto i = m_head.load(std::memory_order_relaxed); i != tail; ++i)
+            m_buffer[i & m_mask].~value_type();
+
+        allocator_type().deallocate(m_buffer, m_capacity);
+    }
+
+    /** Try to add an element, without blocking.
+        Must only be called from the producer thread.
+        \returns false if the queue is full. The value is left untouched in that case.
+     */
+    template <class U> bool try_push(U&& value)
+    {
+        auto const tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cached_head == m_capacity)
+        {
+            m_cached_head = m_head.load(std::memory_order_acquire);
+            if (tail - m_cached_head == m_capacity)
+                return false;
+        }
+
+        new (m_buffer + (tail & m_mask)) value_type(std::forward<U>(value));
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** Try to remove an element, without blocking.
+        Must only be called from the consumer thread.
+        \returns The element, or nothing if the queue is empty.
+     */
+    std::optional<value_type> try_pop()
+    {
+        auto const head = m_head.load(std::memory_order_relaxed);
+        if (head == m_cached_tail)
+        {
+            m_cached_tail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cached_tail)
+                return {};
+        }
+
+        auto& slot = m_buffer[head & m_mask];
+        std::optional<value_type> result(std::move(slot));
+        slot.~value_type();
+        m_head.store(head + 1, std::memory_order_release);
+        return result;
+    }
+
+    /** Add an element, waiting for free space if the queue is full.
+        Waiting spins and yields the thread, so this is meant for queues that are rarely full.
+     */
+    template <class U> void push(U&& value)
+    {
+        while (!try_push(std::forward<U>(value)))
+            std::this_thread::yield();
+    }
+
+    /** Remove an element, waiting for one to arrive if the queue is empty.
+        Waiting spins and yields the thread, so this is meant for queues that are rarely empty.
+     */
+    value_type pop()
+    {
+        while (true)
+        {
+            if (auto result = try_pop())
+                return std::move(*result);
+
+            std::this_thread::yield();
+        }
+    }
+
+    /** Check if the queue is empty.
+        This is only a snapshot unless called from the consumer thread.
+     */
+    bool empty() const
+    {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+    /** Number of elements in the queue.
+        This is only a snapshot when other threads are pushing or popping.
+     */
+    size_type size() const
+    {
+        auto const head = m_head.load(std::memory_order_acquire);
+        return m_tail.load(std::memory_order_acquire) - head;
+    }
+
+    /** The maximum number of elements the queue can hold.
+     */
+    size_type capacity() const
+    {
+        return m_capacity;
+    }
+
+private:
+    // Written by the producer
+    alignas(cache_line_size) std::atomic<size_type> m_tail{ 0 };
+    size_type m_cached_head = 0;
+
+    // Written by the consumer
+    alignas(cache_line_size) std::atomic<size_type> m_head{ 0 };
+    size_type m_cached_tail = 0;
+
+    // Read-only after construction
+    alignas(cache_line_size) size_type const m_capacity;
+    size_type const m_mask;
+    value_type* const m_buffer;
+};
+} // namespace replay
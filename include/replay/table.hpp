@@ -28,45 +28,584 @@ Copyright (c) 2010-2019 Marius Elvert
 #define replay_table_hpp
 
 #include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <numeric>
+#include <replay/aligned_allocator.hpp>
+#include <type_traits>
+#include <utility>
 
 namespace replay
 {
 
+/** Plain row-major memory layout for \ref table. This is the default.
+    \ingroup Container
+*/
+class row_major_layout
+{
+public:
+    typedef std::size_t size_type;
+
+    row_major_layout(size_type w, size_type h)
+    : m_width(w)
+    , m_height(h)
+    {
+    }
+
+    /** Number of elements that need to be allocated.
+     */
+    size_type size() const
+    {
+        return m_width * m_height;
+    }
+
+    /** Compute the linear memory offset of an element.
+     */
+    size_type offset(size_type x, size_type y) const
+    {
+        return (m_width * y) + x;
+    }
+
+    /** Distance between the starts of two rows in elements.
+     */
+    size_type row_stride() const
+    {
+        return m_width;
+    }
+
+    /** Call function(x, offset, count) for each contiguous segment of a row.
+     */
+    template <class Function> void for_each_row_segment(size_type y, Function&& function) const
+    {
+        function(size_type(0), offset(0, y), m_width);
+    }
+
+    /** Call function(x, y, offset) for each element in memory order.
+     */
+    template <class Function> void for_each_position(Function&& function) const
+    {
+        size_type i = 0;
+        for (size_type y = 0; y < m_height; ++y)
+            for (size_type x = 0; x < m_width; ++x)
+                function(x, y, i++);
+    }
+
+private:
+    size_type m_width;
+    size_type m_height;
+};
+
+/** Row-major memory layout for \ref table that pads each row, so that all rows start on an aligned address.
+    \tparam RowMultiple The row stride is rounded up to a multiple of this many elements.
+    \tparam Alignment Alignment of the table's buffer in bytes.
+    \see aligned_row_layout
+    \ingroup Container
+*/
+template <std::size_t RowMultiple, std::size_t Alignment> class padded_row_layout
+{
+public:
+    typedef std::size_t size_type;
+
+    static constexpr size_type alignment = Alignment;
+
+    padded_row_layout(size_type w, size_type h)
+    : m_width(w)
+    , m_height(h)
+    , m_stride((w + RowMultiple - 1) / RowMultiple * RowMultiple)
+    {
+    }
+
+    /** Number of elements that need to be allocated, including padding.
+     */
+    size_type size() const
+    {
+        return m_stride * m_height;
+    }
+
+    /** Compute the linear memory offset of an element.
+     */
+    size_type offset(size_type x, size_type y) const
+    {
+        return (m_stride * y) + x;
+    }
+
+    /** Distance between the starts of two rows in elements.
+     */
+    size_type row_stride() const
+    {
+        return m_stride;
+    }
+
+    /** Call function(x, offset, count) for each contiguous segment of a row.
+     */
+    template <class Function> void for_each_row_segment(size_type y, Function&& function) const
+    {
+        function(size_type(0), offset(0, y), m_width);
+    }
+
+    /** Call function(x, y, offset) for each element in memory order.
+     */
+    template <class Function> void for_each_position(Function&& function) const
+    {
+        for (size_type y = 0; y < m_height; ++y)
+        {
+            auto i = offset(0, y);
+            for (size_type x = 0; x < m_width; ++x)
+                function(x, y, i++);
+        }
+    }
+
+private:
+    size_type m_width;
+    size_type m_height;
+    size_type m_stride;
+};
+
+/** Row-major layout where every row of a table of T starts on an Alignment byte boundary, e.g. for SIMD loads.
+    \ingroup Container
+*/
+template <class T, std::size_t Alignment = 64>
+using aligned_row_layout = padded_row_layout<Alignment / std::gcd(Alignment, sizeof(T)), Alignment>;
+
+namespace detail
+{
+
+/** Buffer alignment a \ref table with the given layout needs.
+ */
+template <class Layout, class T, class = void> struct table_alignment : std::integral_constant<std::size_t, alignof(T)>
+{
+};
+
+template <class Layout, class T>
+struct table_alignment<Layout, T, std::void_t<decltype(Layout::alignment)>>
+: std::integral_constant<std::size_t, (Layout::alignment > alignof(T) ? Layout::alignment : alignof(T))>
+{
+};
+
+} // namespace detail
+
+/** Memory layout for \ref table that stores square tiles contiguously.
+    Neighborhood accesses and vertical scans then mostly stay within a few cache lines.
+    The table is padded to a multiple of the tile size in both directions.
+    \ingroup Container
+*/
+template <std::size_t TileSize = 8> class tiled_layout
+{
+public:
+    typedef std::size_t size_type;
+
+    static_assert(TileSize > 0 && (TileSize & (TileSize - 1)) == 0, "Tile size has to be a power of two");
+
+    static constexpr size_type tile_size = TileSize;
+
+    tiled_layout(size_type w, size_type h)
+    : m_width(w)
+    , m_height(h)
+    , m_tiles_x((w + TileSize - 1) / TileSize)
+    , m_tiles_y((h + TileSize - 1) / TileSize)
+    {
+    }
+
+    /** Number of elements that need to be allocated, including padding.
+     */
+    size_type size() const
+    {
+        return m_tiles_x * m_tiles_y * TileSize * TileSize;
+    }
+
+    /** Compute the linear memory offset of an element.
+     */
+    size_type offset(size_type x, size_type y) const
+    {
+        return ((y / TileSize) * m_tiles_x + x / TileSize) * (TileSize * TileSize) + (y % TileSize) * TileSize +
+               x % TileSize;
+    }
+
+    /** Call function(x, offset, count) for each contiguous segment of a row.
+     */
+    template <class Function> void for_each_row_segment(size_type y, Function&& function) const
+    {
+        for (size_type x = 0; x < m_width; x += TileSize)
+            function(x, offset(x, y), std::min(TileSize, m_width - x));
+    }
+
+    /** Call function(x, y, offset) for each element in memory order, i.e. tile by tile.
+     */
+    template <class Function> void for_each_position(Function&& function) const
+    {
+        for (size_type tile_y = 0; tile_y < m_height; tile_y += TileSize)
+        {
+            for (size_type tile_x = 0; tile_x < m_width; tile_x += TileSize)
+            {
+                auto const y_end = std::min(tile_y + TileSize, m_height);
+                auto const x_end = std::min(tile_x + TileSize, m_width);
+                for (size_type y = tile_y; y < y_end; ++y)
+                {
+                    auto i = offset(tile_x, y);
+                    for (size_type x = tile_x; x < x_end; ++x)
+                        function(x, y, i++);
+                }
+            }
+        }
+    }
+
+private:
+    size_type m_width;
+    size_type m_height;
+    size_type m_tiles_x;
+    size_type m_tiles_y;
+};
+
+/** Memory layout for \ref table in Z-order, i.e. with interleaved coordinate bits.
+    Elements close in both directions are close in memory at every scale. Each dimension is padded to a power of two,
+    and non-square tables are stored as a sequence of Z-ordered squares.
+    \ingroup Container
+*/
+class morton_layout
+{
+public:
+    typedef std::size_t size_type;
+
+    morton_layout(size_type w, size_type h)
+    : m_width(w)
+    , m_height(h)
+    , m_padded_width(next_power_of_two(w))
+    , m_padded_height(next_power_of_two(h))
+    , m_block_shift(0)
+    {
+        while ((size_type(1) << m_block_shift) < std::min(m_padded_width, m_padded_height))
+            ++m_block_shift;
+    }
+
+    /** Number of elements that need to be allocated, including padding.
+     */
+    size_type size() const
+    {
+        return (m_width && m_height) ? m_padded_width * m_padded_height : 0;
+    }
+
+    /** Compute the linear memory offset of an element.
+     */
+    size_type offset(size_type x, size_type y) const
+    {
+        auto const mask = (size_type(1) << m_block_shift) - 1;
+        auto const block = (m_padded_width > m_padded_height ? x : y) >> m_block_shift;
+        return (block << (2 * m_block_shift)) | (spread_bits(x & mask) | (spread_bits(y & mask) << 1));
+    }
+
+    /** Call function(x, offset, count) for each contiguous segment of a row.
+        Only pairs of elements are contiguous in this layout.
+    */
+    template <class Function> void for_each_row_segment(size_type y, Function&& function) const
+    {
+        for (size_type x = 0; x < m_width; x += 2)
+            function(x, offset(x, y), std::min(size_type(2), m_width - x));
+    }
+
+    /** Call function(x, y, offset) for each element in memory order.
+     */
+    template <class Function> void for_each_position(Function&& function) const
+    {
+        auto const block_size = size_type(1) << (2 * m_block_shift);
+        auto const mask = block_size - 1;
+        for (size_type i = 0, n = size(); i < n; ++i)
+        {
+            auto const block = (i >> (2 * m_block_shift)) << m_block_shift;
+            auto x = compact_bits(i & mask);
+            auto y = compact_bits((i & mask) >> 1);
+            (m_padded_width > m_padded_height ? x : y) += block;
+            if (x < m_width && y < m_height)
+                function(x, y, i);
+        }
+    }
+
+private:
+    static size_type next_power_of_two(size_type value)
+    {
+        size_type result = 1;
+        while (result < value)
+            result <<= 1;
+        return result;
+    }
+
+    /** Move the lower 32 bits to the even bit positions.
+     */
+    static size_type spread_bits(size_type value)
+    {
+        std::uint64_t x = value & 0xFFFFFFFFu;
+        x = (x | (x << 16)) & 0x0000FFFF0000FFFFull;
+        x = (x | (x << 8)) & 0x00FF00FF00FF00FFull;
+        x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0Full;
+        x = (x | (x << 2)) & 0x3333333333333333ull;
+        x = (x | (x << 1)) & 0x5555555555555555ull;
+        return static_cast<size_type>(x);
+    }
+
+    /** Inverse of spread_bits: gather the even bit positions.
+     */
+    static size_type compact_bits(size_type value)
+    {
+        std::uint64_t x = value & 0x5555555555555555ull;
+        x = (x | (x >> 1)) & 0x3333333333333333ull;
+        x = (x | (x >> 2)) & 0x0F0F0F0F0F0F0F0Full;
+        x = (x | (x >> 4)) & 0x00FF00FF00FF00FFull;
+        x = (x | (x >> 8)) & 0x0000FFFF0000FFFFull;
+        x = (x | (x >> 16)) & 0x00000000FFFFFFFFull;
+        return static_cast<size_type>(x);
+    }
+
+    size_type m_width;
+    size_type m_height;
+    size_type m_padded_width;
+    size_type m_padded_height;
+    size_type m_block_shift;
+};
+
+namespace detail
+{
+
+/** Whether a layout stores exactly the elements of the table in row-major order, without any padding.
+    Tables with such a layout can use plain pointers as iterators.
+ */
+template <class Layout> struct is_dense_layout : std::false_type
+{
+};
+
+template <> struct is_dense_layout<row_major_layout> : std::true_type
+{
+};
+
+/** Whether the rows of a layout are contiguous, i.e. the layout has a row stride.
+ */
+template <class Layout, class = void> struct has_row_stride : std::false_type
+{
+};
+
+template <class Layout>
+struct has_row_stride<Layout, std::void_t<decltype(std::declval<Layout const&>().row_stride())>> : std::true_type
+{
+};
+
+} // namespace detail
+
+/** Iterator over a rectangular region of a \ref table, going row by row from left to right.
+    Padding of the table's layout is never visited.
+    \tparam T The element type, const-qualified for immutable iteration.
+    \ingroup Container
+*/
+template <class T, class Layout> class table_region_iterator
+{
+public:
+    typedef std::size_t size_type;
+    typedef std::remove_const_t<T> value_type;
+    typedef T& reference;
+    typedef T* pointer;
+    typedef std::ptrdiff_t difference_type;
+    typedef std::forward_iterator_tag iterator_category;
+
+    table_region_iterator() = default;
+
+    /** Create an iterator at (x, y) of the region with the columns [left, right).
+     */
+    table_region_iterator(T* buffer, Layout const* layout, size_type left, size_type right, size_type x, size_type y)
+    : m_buffer(buffer)
+    , m_layout(layout)
+    , m_left(left)
+    , m_right(right)
+    , m_x(x)
+    , m_y(y)
+    {
+    }
+
+    /** Allow conversion from mutable to immutable iterators.
+     */
+    template <class U, class = std::enable_if_t<std::is_same<U const, T>::value && !std::is_same<U, T>::value>>
+    table_region_iterator(table_region_iterator<U, Layout> const& rhs)
+    : table_region_iterator(rhs.buffer(), rhs.layout(), rhs.left(), rhs.right(), rhs.x(), rhs.y())
+    {
+    }
+
+    reference operator*() const
+    {
+        return m_buffer[m_layout->offset(m_x, m_y)];
+    }
+
+    pointer operator->() const
+    {
+        return &**this;
+    }
+
+    table_region_iterator& operator++()
+    {
+        if (++m_x == m_right)
+        {
+            m_x = m_left;
+            ++m_y;
+        }
+        return *this;
+    }
+
+    table_region_iterator operator++(int)
+    {
+        auto result = *this;
+        ++(*this);
+        return result;
+    }
+
+    bool operator==(table_region_iterator const& rhs) const
+    {
+        return m_x == rhs.m_x && m_y == rhs.m_y;
+    }
+
+    bool operator!=(table_region_iterator const& rhs) const
+    {
+        return !(*this == rhs);
+    }
+
+    /** Column of the current element.
+     */
+    size_type x() const
+    {
+        return m_x;
+    }
+
+    /** Row of the current element.
+     */
+    size_type y() const
+    {
+        return m_y;
+    }
+
+    size_type left() const
+    {
+        return m_left;
+    }
+
+    size_type right() const
+    {
+        return m_right;
+    }
+
+    T* buffer() const
+    {
+        return m_buffer;
+    }
+
+    Layout const* layout() const
+    {
+        return m_layout;
+    }
+
+private:
+    T* m_buffer = nullptr;
+    Layout const* m_layout = nullptr;
+    size_type m_left = 0;
+    size_type m_right = 0;
+    size_type m_x = 0;
+    size_type m_y = 0;
+};
+
+/** A pair of iterators that can be used in range-based for loops and with standard algorithms.
+    \ingroup Container
+*/
+template <class Iterator> class table_range
+{
+public:
+    typedef Iterator iterator;
+
+    table_range(Iterator begin, Iterator end)
+    : m_begin(begin)
+    , m_end(end)
+    {
+    }
+
+    Iterator begin() const
+    {
+        return m_begin;
+    }
+
+    Iterator end() const
+    {
+        return m_end;
+    }
+
+private:
+    Iterator m_begin;
+    Iterator m_end;
+};
+
 /** A dynamicly sized two dimensional array class.
     Tables of size \f$0x0\f$ are called invalid - they do not maintain
     any additional memory and no elements can be accessed.
+    \tparam Layout Memory layout policy, e.g. \ref row_major_layout, \ref aligned_row_layout, \ref tiled_layout or
+    \ref morton_layout.
     \note Consider using \ref fixed_table instead when the size is known at compile time.
     \ingroup Container
 */
-template <class T> class table
+template <class T, class Layout = row_major_layout> class table
 {
 public:
     typedef T value_type;
     typedef std::size_t size_type;
+    typedef Layout layout_type;
+    typedef aligned_allocator<T, detail::table_alignment<Layout, T>::value> allocator_type;
+
+    /** Iterator over a rectangular region of the table.
+     */
+    typedef table_region_iterator<value_type, layout_type> region_iterator;
+
+    /** Immutable iterator over a rectangular region of the table.
+     */
+    typedef table_region_iterator<const value_type, layout_type> const_region_iterator;
 
     /** An iterator to use with this type.
-        \note This is currently implemented as a raw pointer.
+        Iterates all elements row by row, skipping the padding of the layout.
+        \note This is a raw pointer for \ref row_major_layout.
     */
-    typedef value_type* iterator;
+    typedef std::conditional_t<detail::is_dense_layout<Layout>::value, value_type*, region_iterator> iterator;
 
     /** An immutable iterator to use with this type.
-        \note This is currently implemented as a const raw pointer.
+        Iterates all elements row by row, skipping the padding of the layout.
+        \note This is a const raw pointer for \ref row_major_layout.
     */
-    typedef const value_type* const_iterator;
+    typedef std::conditional_t<detail::is_dense_layout<Layout>::value, const value_type*, const_region_iterator>
+        const_iterator;
 
-    /** Fill the table with the given value.
+    /** Iterator over a single row. This is a raw pointer if the layout stores rows contiguously.
+     */
+    typedef std::conditional_t<detail::has_row_stride<Layout>::value, value_type*, region_iterator> row_iterator;
+
+    /** Immutable iterator over a single row. This is a const raw pointer if the layout stores rows contiguously.
+     */
+    typedef std::conditional_t<detail::has_row_stride<Layout>::value, const value_type*, const_region_iterator>
+        const_row_iterator;
+
+    /** Fill the table with the given value. The padding of the layout is left untouched.
      */
     void fill(const value_type& value)
     {
-        const size_type num_elements = m_width * m_height;
-        for (size_type i = 0; i < num_elements; ++i)
-            m_buffer[i] = value;
+        if constexpr (detail::is_dense_layout<Layout>::value)
+        {
+            std::fill_n(m_buffer, m_layout.size(), value);
+        }
+        else
+        {
+            for (size_type y = 0; y < m_height; ++y)
+            {
+                m_layout.for_each_row_segment(y, [&](size_type, size_type offset, size_type count) {
+                    std::fill_n(m_buffer + offset, count, value);
+                });
+            }
+        }
     }
 
     /** Construct a table of given width and height.
      */
     table(size_type w, size_type h)
-    : m_buffer((w && h) ? new value_type[w * h] : 0)
+    : m_layout(w, h)
+    , m_buffer((w && h) ? allocate_elements(m_layout.size()) : 0)
     , m_width(w)
     , m_height(h)
     {
@@ -75,26 +614,25 @@ public:
     /** Construct a table of given width and height and fill it with the given value.
      */
     table(size_type w, size_type h, const value_type& value)
-    : m_buffer((w && h) ? new value_type[w * h] : 0)
+    : m_layout(w, h)
+    , m_buffer(0)
     , m_width(w)
     , m_height(h)
     {
-        try
-        {
-            fill(value);
-        }
-        catch (...)
-        {
-            delete[] m_buffer;
-            throw;
-        }
+        if (!m_width || !m_height)
+            return;
+
+        m_buffer = allocate_elements(m_layout, [&](value_type* target, size_type, size_type, size_type) {
+            new (target) value_type(value);
+        });
     }
 
     /** Default constructor.
         Creates an invalid table.
     */
     table()
-    : m_buffer(0)
+    : m_layout(0, 0)
+    , m_buffer(0)
     , m_width(0)
     , m_height(0)
     {
@@ -103,37 +641,31 @@ public:
     /** Copy constructor.
         Will create a table of equal size and copy all elements over.
     */
-    table(table<value_type> const& rhs)
-    : m_buffer(0)
+    table(table const& rhs)
+    : m_layout(rhs.m_layout)
+    , m_buffer(0)
     , m_width(rhs.m_width)
     , m_height(rhs.m_height)
     {
         if (!m_width || !m_height)
             return;
-        
-        const size_type num_elements = m_width * m_height;
-        m_buffer = new value_type[num_elements];
 
-        try
-        {
-            for (size_type i = 0; i < num_elements; ++i)
-                m_buffer[i] = rhs.m_buffer[i];
-        }
-        catch (...)
-        {
-            delete[] m_buffer;
-            throw;
-        }        
+        const value_type* const source = rhs.m_buffer;
+        m_buffer = allocate_elements(m_layout, [&](value_type* target, size_type, size_type, size_type i) {
+            new (target) value_type(source[i]);
+        });
     }
 
     /** Move constructor.
         Leaves the source in a state equivalent to default-constructed.
     */
     table(table&& rhs) noexcept
-    : m_buffer(rhs.m_buffer)
+    : m_layout(rhs.m_layout)
+    , m_buffer(rhs.m_buffer)
     , m_width(rhs.m_width)
     , m_height(rhs.m_height)
     {
+        rhs.m_layout = layout_type(0, 0);
         rhs.m_buffer = nullptr;
         rhs.m_width = 0;
         rhs.m_height = 0;
@@ -144,44 +676,127 @@ public:
     */
     ~table()
     {
-        delete[] m_buffer;
+        free_elements(m_buffer, m_layout.size());
     }
 
     /** Get an iterator to the beginning of the table.
      */
     iterator begin()
     {
-        return iterator(m_buffer);
+        if constexpr (detail::is_dense_layout<Layout>::value)
+            return m_buffer;
+        else
+            return region(0, 0, m_width, m_height).begin();
     }
 
     /** Get an iterator to the beginning of the table.
      */
     const_iterator begin() const
     {
-        return const_iterator(m_buffer);
+        if constexpr (detail::is_dense_layout<Layout>::value)
+            return m_buffer;
+        else
+            return region(0, 0, m_width, m_height).begin();
     }
 
     /** Get an iterator the end of the table.
      */
     iterator end()
     {
-        return iterator(m_buffer + width() * height());
+        if constexpr (detail::is_dense_layout<Layout>::value)
+            return m_buffer + m_layout.size();
+        else
+            return region(0, 0, m_width, m_height).end();
     }
 
     /** Get an iterator the end of the table.
      */
     const_iterator end() const
     {
-        return const_iterator(m_buffer + width() * height());
+        if constexpr (detail::is_dense_layout<Layout>::value)
+            return m_buffer + m_layout.size();
+        else
+            return region(0, 0, m_width, m_height).end();
+    }
+
+    /** Get the elements of a rectangular region, row by row.
+        \param x The leftmost column of the region.
+        \param y The top row of the region.
+        \param w The width of the region.
+        \param h The height of the region.
+    */
+    table_range<region_iterator> region(size_type x, size_type y, size_type w, size_type h)
+    {
+        auto const end_y = (w && h) ? y + h : y;
+        return { region_iterator(m_buffer, &m_layout, x, x + w, x, y),
+                 region_iterator(m_buffer, &m_layout, x, x + w, x, end_y) };
+    }
+
+    /** Get the elements of a rectangular region, row by row.
+        \param x The leftmost column of the region.
+        \param y The top row of the region.
+        \param w The width of the region.
+        \param h The height of the region.
+    */
+    table_range<const_region_iterator> region(size_type x, size_type y, size_type w, size_type h) const
+    {
+        auto const end_y = (w && h) ? y + h : y;
+        return { const_region_iterator(m_buffer, &m_layout, x, x + w, x, y),
+                 const_region_iterator(m_buffer, &m_layout, x, x + w, x, end_y) };
+    }
+
+    /** Get the elements of a row, from left to right.
+     */
+    table_range<row_iterator> row(size_type y)
+    {
+        if constexpr (detail::has_row_stride<Layout>::value)
+            return { m_buffer + m_layout.offset(0, y), m_buffer + m_layout.offset(0, y) + m_width };
+        else
+            return region(0, y, m_width, 1);
+    }
+
+    /** Get the elements of a row, from left to right.
+     */
+    table_range<const_row_iterator> row(size_type y) const
+    {
+        if constexpr (detail::has_row_stride<Layout>::value)
+            return { m_buffer + m_layout.offset(0, y), m_buffer + m_layout.offset(0, y) + m_width };
+        else
+            return region(0, y, m_width, 1);
+    }
+
+    /** Get the elements of a tile, row by row. Only available for layouts with a tile size, like \ref tiled_layout.
+        Tiles at the right and bottom border are clipped to the table.
+        \param tile_x The column of the tile, i.e. x / tile_size.
+        \param tile_y The row of the tile, i.e. y / tile_size.
+    */
+    template <class L = Layout> table_range<region_iterator> tile(size_type tile_x, size_type tile_y)
+    {
+        auto const x = tile_x * L::tile_size;
+        auto const y = tile_y * L::tile_size;
+        return region(x, y, std::min(L::tile_size, m_width - x), std::min(L::tile_size, m_height - y));
+    }
+
+    /** Get the elements of a tile, row by row. Only available for layouts with a tile size, like \ref tiled_layout.
+        Tiles at the right and bottom border are clipped to the table.
+        \param tile_x The column of the tile, i.e. x / tile_size.
+        \param tile_y The row of the tile, i.e. y / tile_size.
+    */
+    template <class L = Layout> table_range<const_region_iterator> tile(size_type tile_x, size_type tile_y) const
+    {
+        auto const x = tile_x * L::tile_size;
+        auto const y = tile_y * L::tile_size;
+        return region(x, y, std::min(L::tile_size, m_width - x), std::min(L::tile_size, m_height - y));
     }
 
     /** Invalidate the table and free the memory.
      */
     void clear()
     {
-        delete[] m_buffer;
+        free_elements(m_buffer, m_layout.size());
         m_buffer = nullptr;
 
+        m_layout = layout_type(0, 0);
         m_width = 0;
         m_height = 0;
     }
@@ -194,11 +809,13 @@ public:
         clear();
 
         // Move ownership
+        m_layout = rhs.m_layout;
         m_buffer = rhs.m_buffer;
         m_width = rhs.m_width;
         m_height = rhs.m_height;
         
         // Clear old
+        rhs.m_layout = layout_type(0, 0);
         rhs.m_buffer = nullptr;
         rhs.m_width = 0;
         rhs.m_height = 0;
@@ -230,11 +847,88 @@ public:
         swap(*this, rhs);
     }
 
+    /** Resize the table and keep the contents where the old and new size overlap.
+        Overlapping elements are move-constructed in place, or copied if moving them might throw. All others are
+        default-constructed. If an exception is thrown, the table keeps its old size. No third buffer is needed, so
+        the peak memory is the old plus the new table.
+    */
+    void resize_preserving(size_type w, size_type h)
+    {
+        table rhs;
+        if (w && h)
+        {
+            const layout_type layout(w, h);
+            const size_type overlap_width = std::min(w, m_width);
+            const size_type overlap_height = std::min(h, m_height);
+            value_type* const buffer =
+                allocate_elements(layout, [&](value_type* target, size_type x, size_type y, size_type) {
+                    if (x < overlap_width && y < overlap_height)
+                        new (target) value_type(std::move_if_noexcept((*this)(x, y)));
+                    else
+                        new (target) value_type;
+                });
+
+            rhs.m_layout = layout;
+            rhs.m_buffer = buffer;
+            rhs.m_width = w;
+            rhs.m_height = h;
+        }
+        swap(*this, rhs);
+    }
+
     /** Compute the linear memory offset of an element.
      */
     size_type element_offset(size_type x, size_type y) const
     {
-        return (m_width * y) + x;
+        return m_layout.offset(x, y);
+    }
+
+    /** Call function(x, y, element) for all elements in memory order.
+        Like the iterators, this skips the padding of the layout, but it visits tiled layouts tile by tile.
+    */
+    template <class Function> void for_each(Function&& function)
+    {
+        m_layout.for_each_position([&](size_type x, size_type y, size_type i) { function(x, y, m_buffer[i]); });
+    }
+
+    /** Call function(x, y, element) for all elements in memory order.
+        Like the iterators, this skips the padding of the layout, but it visits tiled layouts tile by tile.
+    */
+    template <class Function> void for_each(Function&& function) const
+    {
+        const value_type* const buffer = m_buffer;
+        m_layout.for_each_position([&](size_type x, size_type y, size_type i) { function(x, y, buffer[i]); });
+    }
+
+    /** Call function(x, element) for all elements in a row, from left to right.
+        Contiguous segments of the row are visited through a plain pointer.
+    */
+    template <class Function> void for_each_in_row(size_type y, Function&& function)
+    {
+        m_layout.for_each_row_segment(y, [&](size_type x, size_type offset, size_type count) {
+            value_type* const segment = m_buffer + offset;
+            for (size_type i = 0; i < count; ++i)
+                function(x + i, segment[i]);
+        });
+    }
+
+    /** Call function(x, element) for all elements in a row, from left to right.
+        Contiguous segments of the row are visited through a plain pointer.
+    */
+    template <class Function> void for_each_in_row(size_type y, Function&& function) const
+    {
+        m_layout.for_each_row_segment(y, [&](size_type x, size_type offset, size_type count) {
+            const value_type* const segment = m_buffer + offset;
+            for (size_type i = 0; i < count; ++i)
+                function(x + i, segment[i]);
+        });
+    }
+
+    /** Get the memory layout.
+     */
+    const layout_type& layout() const
+    {
+        return m_layout;
     }
 
     /** Access the table.
@@ -315,7 +1009,7 @@ public:
 
     /** Get a pointer to the raw %buffer.
         \returns A const pointer to the internal %buffer.
-        \note The internal memory layout is a continguous and row-major.
+        \note The internal memory is contiguous and ordered according to the layout policy.
     */
     const value_type* ptr() const
     {
@@ -324,7 +1018,7 @@ public:
 
     /** Get a pointer to the raw %buffer.
         \returns A mutable pointer to the internal %buffer.
-        \note The internal memory layout is a continguous and row-major.
+        \note The internal memory is contiguous and ordered according to the layout policy.
     */
     value_type* ptr()
     {
@@ -336,6 +1030,10 @@ public:
     */
     static void swap(table& lhs, table& rhs)
     {
+        const layout_type layout = lhs.m_layout;
+        lhs.m_layout = rhs.m_layout;
+        rhs.m_layout = layout;
+
         value_type* const data = lhs.m_buffer;
         lhs.m_buffer = rhs.m_buffer;
         rhs.m_buffer = data;
@@ -358,6 +1056,65 @@ public:
     }
 
 private:
+    /** Allocate and default-construct elements.
+     */
+    static value_type* allocate_elements(size_type count)
+    {
+        value_type* const result = allocator_type().allocate(count);
+        try
+        {
+            std::uninitialized_default_construct_n(result, count);
+        }
+        catch (...)
+        {
+            allocator_type().deallocate(result, count);
+            throw;
+        }
+        return result;
+    }
+
+    /** Allocate the elements for a layout and call construct(target, x, y, offset) to construct each of them
+        in place. Padding is default-constructed. Elements that were already constructed are cleaned up if an
+        exception is thrown.
+    */
+    template <class Construct> static value_type* allocate_elements(layout_type const& layout, Construct&& construct)
+    {
+        const size_type count = layout.size();
+        value_type* const result = allocator_type().allocate(count);
+
+        // Positions are visited at increasing offsets, so everything below this one is constructed
+        size_type constructed = 0;
+        try
+        {
+            layout.for_each_position([&](size_type x, size_type y, size_type i) {
+                std::uninitialized_default_construct(result + constructed, result + i);
+                constructed = i;
+                construct(result + i, x, y, i);
+                constructed = i + 1;
+            });
+            std::uninitialized_default_construct(result + constructed, result + count);
+        }
+        catch (...)
+        {
+            std::destroy_n(result, constructed);
+            allocator_type().deallocate(result, count);
+            throw;
+        }
+        return result;
+    }
+
+    /** Destroy and free elements.
+     */
+    static void free_elements(value_type* buffer, size_type count)
+    {
+        if (buffer == nullptr)
+            return;
+
+        std::destroy_n(buffer, count);
+        allocator_type().deallocate(buffer, count);
+    }
+
+    layout_type m_layout;
     value_type* m_buffer;
     size_type m_width;
     size_type m_height;
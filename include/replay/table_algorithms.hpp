@@ -0,0 +1,252 @@
+/*
+replay
+Software Library
+
+Copyright (c) 2010-2019 Marius Elvert
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <replay/table.hpp>
+#include <replay/table_view.hpp>
+#include <replay/thread_pool.hpp>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace replay
+{
+
+/** Neighborhood of an element that is passed to the function of \ref stencil.
+    At the borders of the table, coordinates are clamped to the nearest element.
+    \tparam Radius 1 for a 3x3 neighborhood, 2 for 5x5.
+    \tparam Clamped Whether horizontal coordinates need clamping. Only elements close to the left and right border do.
+*/
+template <class T, std::size_t Radius, bool Clamped> class stencil_window
+{
+public:
+    static constexpr std::ptrdiff_t radius = static_cast<std::ptrdiff_t>(Radius);
+
+    stencil_window(T const* const* rows, std::ptrdiff_t x, std::ptrdiff_t width)
+    : m_rows(rows)
+    , m_x(x)
+    , m_width(width)
+    {
+    }
+
+    /** Access an element relative to the center, with dx and dy in [-radius, radius].
+     */
+    T const& operator()(std::ptrdiff_t dx, std::ptrdiff_t dy) const
+    {
+        auto x = m_x + dx;
+        if (Clamped)
+            x = std::min(std::max(x, std::ptrdiff_t(0)), m_width - 1);
+        return m_rows[dy + radius][x];
+    }
+
+    /** The center element.
+     */
+    T const& center() const
+    {
+        return m_rows[radius][m_x];
+    }
+
+    std::size_t x() const
+    {
+        return static_cast<std::size_t>(m_x);
+    }
+
+private:
+    T const* const* m_rows;
+    std::ptrdiff_t m_x;
+    std::ptrdiff_t m_width;
+};
+
+namespace detail
+{
+
+template <class T, class Layout> T* table_row(table<T, Layout>& rhs, std::size_t y)
+{
+    return rhs.ptr() + rhs.layout().row_stride() * y;
+}
+
+template <class T, class Layout> T const* table_row(table<T, Layout> const& rhs, std::size_t y)
+{
+    return rhs.ptr() + rhs.layout().row_stride() * y;
+}
+
+/** Only defined if all arguments are tables or table views, to keep the algorithms below out of overload resolution
+    for other types. Otherwise unqualified calls to same-named algorithms can become ambiguous.
+*/
+template <class... Tables>
+using require_tables = std::void_t<decltype(table_row(std::declval<Tables&>(), std::size_t{}))...>;
+
+template <class Lhs, class Rhs> void check_same_size(Lhs const& lhs, Rhs const& rhs)
+{
+    if (lhs.width() != rhs.width() || lhs.height() != rhs.height())
+        throw std::invalid_argument("Tables need to have the same size");
+}
+
+} // namespace detail
+
+/** Set each element of destination to function(element of source), processing rows in parallel.
+    The inner loop works on plain row pointers, so simple arithmetic functions can be vectorized by the compiler.
+    Source and destination can be tables or \ref table_view.
+    \note The algorithms in this header require contiguous rows, e.g. \ref row_major_layout or
+    \ref aligned_row_layout.
+*/
+template <class Source, class Destination, class Function, class = detail::require_tables<Source const, Destination>>
+void transform(thread_pool& pool, Source const& source, Destination&& destination, Function function)
+{
+    detail::check_same_size(source, destination);
+    auto const width = source.width();
+    parallel_for(pool, 0, source.height(), 0, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t y = begin; y < end; ++y)
+        {
+            auto const input = detail::table_row(source, y);
+            auto const output = detail::table_row(destination, y);
+            for (std::size_t x = 0; x < width; ++x)
+                output[x] = function(input[x]);
+        }
+    });
+}
+
+/** Set each element of destination to function(element of source) on the shared pool.
+ */
+template <class Source, class Destination, class Function, class = detail::require_tables<Source const, Destination>>
+void transform(Source const& source, Destination&& destination, Function function)
+{
+    transform(thread_pool::shared(), source, std::forward<Destination>(destination), std::move(function));
+}
+
+/** Set each element of destination to function(element of lhs, element of rhs), processing rows in parallel.
+ */
+template <class Lhs, class Rhs, class Destination, class Function,
+          class = detail::require_tables<Lhs const, Rhs const, Destination>>
+void zip_transform(thread_pool& pool, Lhs const& lhs, Rhs const& rhs, Destination&& destination, Function function)
+{
+    detail::check_same_size(lhs, rhs);
+    detail::check_same_size(lhs, destination);
+    auto const width = lhs.width();
+    parallel_for(pool, 0, lhs.height(), 0, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t y = begin; y < end; ++y)
+        {
+            auto const lhs_row = detail::table_row(lhs, y);
+            auto const rhs_row = detail::table_row(rhs, y);
+            auto const output = detail::table_row(destination, y);
+            for (std::size_t x = 0; x < width; ++x)
+                output[x] = function(lhs_row[x], rhs_row[x]);
+        }
+    });
+}
+
+/** Set each element of destination to function(element of lhs, element of rhs) on the shared pool.
+ */
+template <class Lhs, class Rhs, class Destination, class Function,
+          class = detail::require_tables<Lhs const, Rhs const, Destination>>
+void zip_transform(Lhs const& lhs, Rhs const& rhs, Destination&& destination, Function function)
+{
+    zip_transform(thread_pool::shared(), lhs, rhs, std::forward<Destination>(destination), std::move(function));
+}
+
+/** Fold all elements with combine(value, element), processing rows in parallel.
+    Partial results of row blocks are folded with combine(value, value), so combine needs to be associative and
+    identity needs to be its neutral element.
+*/
+template <class Source, class Value, class CombineFunction, class = detail::require_tables<Source const>>
+Value reduce(thread_pool& pool, Source const& source, Value identity, CombineFunction combine)
+{
+    auto const width = source.width();
+    auto map = [&](std::size_t begin, std::size_t end) {
+        Value result = identity;
+        for (std::size_t y = begin; y < end; ++y)
+        {
+            auto const input = detail::table_row(source, y);
+            for (std::size_t x = 0; x < width; ++x)
+                result = combine(result, input[x]);
+        }
+        return result;
+    };
+    return parallel_reduce(pool, 0, source.height(), 0, identity, map, combine);
+}
+
+/** Fold all elements with combine(value, element) on the shared pool.
+ */
+template <class Source, class Value, class CombineFunction, class = detail::require_tables<Source const>>
+Value reduce(Source const& source, Value identity, CombineFunction combine)
+{
+    return reduce(thread_pool::shared(), source, std::move(identity), std::move(combine));
+}
+
+/** Set each element of destination to function(window), where window is a \ref stencil_window around the
+    corresponding element of source. Rows are processed in parallel.
+    \tparam Radius 1 for a 3x3 stencil, 2 for 5x5.
+    \note Source and destination must not overlap.
+*/
+template <std::size_t Radius, class Source, class Destination, class Function,
+          class = detail::require_tables<Source const, Destination>>
+void stencil(thread_pool& pool, Source const& source, Destination&& destination, Function function)
+{
+    static_assert(Radius == 1 || Radius == 2, "Only 3x3 and 5x5 stencils are supported");
+    detail::check_same_size(source, destination);
+
+    auto const width = static_cast<std::ptrdiff_t>(source.width());
+    auto const height = static_cast<std::ptrdiff_t>(source.height());
+    auto const radius = static_cast<std::ptrdiff_t>(Radius);
+    auto const interior_begin = std::min(radius, width);
+    auto const interior_end = std::max(interior_begin, width - radius);
+
+    parallel_for(pool, 0, source.height(), 0, [&](std::size_t begin, std::size_t end) {
+        using value_type = std::remove_const_t<std::remove_pointer_t<decltype(detail::table_row(source, 0))>>;
+        value_type const* rows[2 * Radius + 1];
+
+        for (auto y = static_cast<std::ptrdiff_t>(begin); y < static_cast<std::ptrdiff_t>(end); ++y)
+        {
+            for (std::ptrdiff_t dy = -radius; dy <= radius; ++dy)
+            {
+                auto const row = std::min(std::max(y + dy, std::ptrdiff_t(0)), height - 1);
+                rows[dy + radius] = detail::table_row(source, static_cast<std::size_t>(row));
+            }
+
+            auto const output = detail::table_row(destination, static_cast<std::size_t>(y));
+            for (std::ptrdiff_t x = 0; x < interior_begin; ++x)
+                output[x] = function(stencil_window<value_type, Radius, true>(rows, x, width));
+            for (std::ptrdiff_t x = interior_begin; x < interior_end; ++x)
+                output[x] = function(stencil_window<value_type, Radius, false>(rows, x, width));
+            for (std::ptrdiff_t x = interior_end; x < width; ++x)
+                output[x] = function(stencil_window<value_type, Radius, true>(rows, x, width));
+        }
+    });
+}
+
+/** Apply a 3x3 or 5x5 stencil on the shared pool.
+ */
+template <std::size_t Radius, class Source, class Destination, class Function,
+          class = detail::require_tables<Source const, Destination>>
+void stencil(Source const& source, Destination&& destination, Function function)
+{
+    stencil<Radius>(thread_pool::shared(), source, std::forward<Destination>(destination), std::move(function));
+}
+
+} // namespace replay
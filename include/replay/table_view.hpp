@@ -0,0 +1,208 @@
+/*
+replay
+Software Library
+
+Copyright (c) 2010-2019 Marius Elvert
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <replay/box.hpp>
+#include <replay/table.hpp>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace replay
+{
+
+/** Non-owning view of a rectangular region in a two dimensional array.
+    Rows are contiguous and stride elements apart, so a view can refer to a whole \ref table, a sub-region of one or
+    any externally owned buffer, without copying.
+    \tparam T Element type, const-qualified for a read-only view.
+    \see const_table_view
+    \ingroup Container
+*/
+template <class T> class table_view
+{
+public:
+    typedef T value_type;
+    typedef std::size_t size_type;
+
+    /** Default constructor.
+        Creates an empty view.
+    */
+    table_view()
+    : m_origin(nullptr)
+    , m_width(0)
+    , m_height(0)
+    , m_stride(0)
+    {
+    }
+
+    /** View a raw buffer.
+        \param origin Pointer to the first element of the first row.
+        \param stride Distance between the starts of two rows in elements. Defaults to the width.
+    */
+    table_view(value_type* origin, size_type w, size_type h, size_type stride = 0)
+    : m_origin(origin)
+    , m_width(w)
+    , m_height(h)
+    , m_stride(stride ? stride : w)
+    {
+    }
+
+    /** View a whole table. The table's layout needs to have contiguous rows.
+     */
+    template <class U,
+              class Layout,
+              class = std::enable_if_t<std::is_convertible<U*, T*>::value>,
+              class = decltype(std::declval<Layout const&>().row_stride())>
+    table_view(table<U, Layout>& rhs)
+    : table_view(rhs.ptr(), rhs.width(), rhs.height(), rhs.layout().row_stride())
+    {
+    }
+
+    /** View a whole table. The table's layout needs to have contiguous rows.
+     */
+    template <class U,
+              class Layout,
+              class = std::enable_if_t<std::is_convertible<U const*, T*>::value>,
+              class = decltype(std::declval<Layout const&>().row_stride())>
+    table_view(table<U, Layout> const& rhs)
+    : table_view(rhs.ptr(), rhs.width(), rhs.height(), rhs.layout().row_stride())
+    {
+    }
+
+    /** Convert a mutable view to an immutable one.
+     */
+    template <class U, class = std::enable_if_t<std::is_convertible<U*, T*>::value>>
+    table_view(table_view<U> const& rhs)
+    : table_view(rhs.ptr(), rhs.width(), rhs.height(), rhs.stride())
+    {
+    }
+
+    /** Get a view of a rectangular region of this view.
+        \throws std::out_of_range if the region is not inside this view.
+    */
+    table_view subview(size_type x, size_type y, size_type w, size_type h) const
+    {
+        if (x > m_width || w > m_width - x || y > m_height || h > m_height - y)
+            throw std::out_of_range("Region exceeds the view");
+
+        return table_view(m_origin + y * m_stride + x, w, h, m_stride);
+    }
+
+    /** Get a view of a rectangular region of this view.
+        The box's left and bottom are the first column and row.
+    */
+    template <class U> table_view subview(box<U> const& region) const
+    {
+        return subview(static_cast<size_type>(region.left), static_cast<size_type>(region.bottom),
+                       static_cast<size_type>(region.get_width()), static_cast<size_type>(region.get_height()));
+    }
+
+    /** Access the view.
+        \param x The column in the view.
+        \param y The row in the view.
+    */
+    value_type& operator()(size_type x, size_type y) const
+    {
+        return m_origin[y * m_stride + x];
+    }
+
+    /** Pointer to the first element of a row.
+     */
+    value_type* row(size_type y) const
+    {
+        return m_origin + y * m_stride;
+    }
+
+    /** Fill all elements of the view with the given value.
+     */
+    template <class U> void fill(U const& value) const
+    {
+        for (size_type y = 0; y < m_height; ++y)
+            std::fill_n(row(y), m_width, value);
+    }
+
+    /** Get the width of the view, i.e. the number of columns.
+     */
+    size_type width() const
+    {
+        return m_width;
+    }
+
+    /** Get the height of the view, i.e. the number of rows.
+     */
+    size_type height() const
+    {
+        return m_height;
+    }
+
+    /** Distance between the starts of two rows in elements.
+     */
+    size_type stride() const
+    {
+        return m_stride;
+    }
+
+    /** Checks whether the view contains no elements.
+     */
+    bool empty() const
+    {
+        return m_width == 0 || m_height == 0;
+    }
+
+    /** Pointer to the first element.
+     */
+    value_type* ptr() const
+    {
+        return m_origin;
+    }
+
+private:
+    value_type* m_origin;
+    size_type m_width;
+    size_type m_height;
+    size_type m_stride;
+};
+
+/** Read-only view of a rectangular region in a two dimensional array.
+ */
+template <class T> using const_table_view = table_view<T const>;
+
+template <class T, class Layout> table_view(table<T, Layout>&)->table_view<T>;
+template <class T, class Layout> table_view(table<T, Layout> const&)->table_view<T const>;
+
+namespace detail
+{
+
+template <class T> T* table_row(table_view<T> const& rhs, std::size_t y)
+{
+    return rhs.row(y);
+}
+
+} // namespace detail
+
+} // namespace replay
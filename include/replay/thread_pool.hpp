@@ -0,0 +1,326 @@
+/*
+replay
+Software Library
+
+Copyright (c) 2010-2019 Marius Elvert
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace replay
+{
+
+/** Type-erased unit of work that can be scheduled on a \ref thread_pool.
+ */
+class thread_pool_task
+{
+public:
+    virtual ~thread_pool_task() = default;
+    virtual void execute() = 0;
+};
+
+/** Work-stealing thread pool.
+    Every worker owns a Chase-Lev deque. Tasks spawned from a worker go to the bottom of its own deque, where
+    that worker picks them up again in LIFO order, while idle workers steal from the top. Tasks spawned from
+    other threads go to a global injection queue. Idle workers sleep on a condition variable.
+    \see parallel_for, parallel_reduce
+ */
+class thread_pool
+{
+public:
+    /** Start the given number of worker threads.
+        \param thread_count Number of workers, or 0 to use one per hardware thread.
+     */
+    explicit thread_pool(std::size_t thread_count = 0);
+
+    /** Stop and join all workers. Tasks that did not run yet are discarded.
+     */
+    ~thread_pool();
+
+    thread_pool(thread_pool const&) = delete;
+    thread_pool& operator=(thread_pool const&) = delete;
+
+    std::size_t thread_count() const;
+
+    /** Schedule a callable to run asynchronously.
+        The callable must not throw.
+     */
+    template <class Function> void submit(Function&& function)
+    {
+        spawn(std::make_unique<function_task<std::decay_t<Function>>>(std::forward<Function>(function)));
+    }
+
+    /** Schedule a task to run asynchronously. The pool takes ownership.
+     */
+    void spawn(std::unique_ptr<thread_pool_task> task);
+
+    /** Run a single pending task on the calling thread, if there is one.
+        This is used to help out instead of blocking while waiting for other tasks.
+        \returns false if no task was found.
+     */
+    bool run_pending_task();
+
+    /** A lazily created pool with one worker per hardware thread, shared by the library's parallel algorithms.
+     */
+    static thread_pool& shared();
+
+private:
+    template <class Function> class function_task : public thread_pool_task
+    {
+    public:
+        template <class F>
+        explicit function_task(F&& function)
+        : m_function(std::forward<F>(function))
+        {
+        }
+
+        void execute() override
+        {
+            m_function();
+        }
+
+    private:
+        Function m_function;
+    };
+
+    struct worker;
+
+    void worker_main(worker& self);
+    thread_pool_task* find_task(worker* self);
+    void notify_task_available();
+    worker* current_worker();
+    static worker*& current_thread_worker();
+
+    std::vector<std::unique_ptr<worker>> m_workers;
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_injection_mutex;
+    std::deque<thread_pool_task*> m_injection_queue;
+
+    std::atomic<std::size_t> m_queued{ 0 };
+    std::atomic<std::size_t> m_sleeping{ 0 };
+    std::atomic<bool> m_stop{ false };
+    std::mutex m_sleep_mutex;
+    std::condition_variable m_wake_signal;
+};
+
+namespace detail
+{
+
+/** Shared state of a blocking parallel loop over chunks of an index range.
+ */
+template <class ChunkFunction> struct parallel_chunks
+{
+    parallel_chunks(thread_pool& pool, std::size_t first, std::size_t last, std::size_t grain_size, ChunkFunction& function)
+    : pool(pool)
+    , function(function)
+    , first(first)
+    , last(last)
+    , grain_size(grain_size)
+    , chunk_count((last - first + grain_size - 1) / grain_size)
+    , remaining(chunk_count)
+    {
+    }
+
+    void run_chunk(std::size_t chunk)
+    {
+        if (!failed.load(std::memory_order_relaxed))
+        {
+            auto const begin = first + chunk * grain_size;
+            auto const end = std::min(last, begin + grain_size);
+            try
+            {
+                function(chunk, begin, end);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error)
+                    error = std::current_exception();
+                failed.store(true, std::memory_order_relaxed);
+            }
+        }
+        remaining.fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    /** Run chunks [begin, end), leaving the upper halves to be stolen by other workers.
+     */
+    void run_chunks(std::size_t begin, std::size_t end);
+
+    thread_pool& pool;
+    ChunkFunction& function;
+    std::size_t const first;
+    std::size_t const last;
+    std::size_t const grain_size;
+    std::size_t const chunk_count;
+    std::atomic<std::size_t> remaining;
+    std::atomic<bool> failed{ false };
+    std::mutex error_mutex;
+    std::exception_ptr error;
+};
+
+template <class ChunkFunction> class parallel_chunks_task : public thread_pool_task
+{
+public:
+    parallel_chunks_task(parallel_chunks<ChunkFunction>& state, std::size_t begin, std::size_t end)
+    : m_state(state)
+    , m_begin(begin)
+    , m_end(end)
+    {
+    }
+
+    void execute() override
+    {
+        m_state.run_chunks(m_begin, m_end);
+    }
+
+private:
+    parallel_chunks<ChunkFunction>& m_state;
+    std::size_t m_begin;
+    std::size_t m_end;
+};
+
+template <class ChunkFunction> void parallel_chunks<ChunkFunction>::run_chunks(std::size_t begin, std::size_t end)
+{
+    while (end - begin > 1)
+    {
+        auto const middle = begin + (end - begin) / 2;
+        pool.spawn(std::make_unique<parallel_chunks_task<ChunkFunction>>(*this, middle, end));
+        end = middle;
+    }
+
+    run_chunk(begin);
+}
+
+inline std::size_t automatic_grain_size(thread_pool& pool, std::size_t count)
+{
+    // Aim for a few chunks per thread so stealing can even out imbalanced work
+    auto const target_chunks = 4 * (pool.thread_count() + 1);
+    return std::max<std::size_t>(1, count / target_chunks);
+}
+
+/** Call function(chunk_index, begin, end) for every grain-sized chunk of [first, last) and wait for completion.
+    The calling thread helps executing tasks while waiting. The first exception thrown is rethrown.
+    \returns The number of chunks.
+ */
+template <class ChunkFunction>
+std::size_t run_parallel_chunks(thread_pool& pool, std::size_t first, std::size_t last, std::size_t grain_size, ChunkFunction& function)
+{
+    if (first >= last)
+        return 0;
+
+    if (grain_size == 0)
+        grain_size = automatic_grain_size(pool, last - first);
+
+    parallel_chunks<ChunkFunction> state(pool, first, last, grain_size, function);
+    state.run_chunks(0, state.chunk_count);
+
+    while (state.remaining.load(std::memory_order_acquire) != 0)
+    {
+        if (!pool.run_pending_task())
+            std::this_thread::yield();
+    }
+
+    if (state.error)
+        std::rethrow_exception(state.error);
+
+    return state.chunk_count;
+}
+
+} // namespace detail
+
+/** Call function(begin, end) on sub-ranges of [first, last) in parallel and wait for all of them to finish.
+    \param grain_size Maximum number of indices per sub-range, or 0 to pick one based on the thread count.
+    \note The calling thread participates in the work, so this can also be called from within a task.
+ */
+template <class Function>
+void parallel_for(thread_pool& pool, std::size_t first, std::size_t last, std::size_t grain_size, Function&& function)
+{
+    auto chunk_function = [&function](std::size_t, std::size_t begin, std::size_t end) { function(begin, end); };
+    detail::run_parallel_chunks(pool, first, last, grain_size, chunk_function);
+}
+
+/** Call function(begin, end) on sub-ranges of [first, last) in parallel on the shared pool.
+ */
+template <class Function> void parallel_for(std::size_t first, std::size_t last, std::size_t grain_size, Function&& function)
+{
+    parallel_for(thread_pool::shared(), first, last, grain_size, std::forward<Function>(function));
+}
+
+/** Reduce the range [first, last) in parallel.
+    Each sub-range is mapped to a value via map(begin, end), and these are folded via combine(lhs, rhs) in index
+    order, starting with identity. The result is deterministic for a given grain size.
+    \param grain_size Maximum number of indices per sub-range, or 0 to pick one based on the thread count.
+ */
+template <class Value, class MapFunction, class CombineFunction>
+Value parallel_reduce(thread_pool& pool,
+                      std::size_t first,
+                      std::size_t last,
+                      std::size_t grain_size,
+                      Value identity,
+                      MapFunction&& map,
+                      CombineFunction&& combine)
+{
+    if (first >= last)
+        return identity;
+
+    if (grain_size == 0)
+        grain_size = detail::automatic_grain_size(pool, last - first);
+
+    std::vector<Value> partial((last - first + grain_size - 1) / grain_size, identity);
+    auto chunk_function = [&](std::size_t chunk, std::size_t begin, std::size_t end) { partial[chunk] = map(begin, end); };
+    detail::run_parallel_chunks(pool, first, last, grain_size, chunk_function);
+
+    Value result = std::move(identity);
+    for (auto& each : partial)
+        result = combine(std::move(result), std::move(each));
+    return result;
+}
+
+/** Reduce the range [first, last) in parallel on the shared pool.
+ */
+template <class Value, class MapFunction, class CombineFunction>
+Value parallel_reduce(std::size_t first,
+                      std::size_t last,
+                      std::size_t grain_size,
+                      Value identity,
+                      MapFunction&& map,
+                      CombineFunction&& combine)
+{
+    return parallel_reduce(thread_pool::shared(), first, last, grain_size, std::move(identity),
+                           std::forward<MapFunction>(map), std::forward<CombineFunction>(combine));
+}
+
+} // namespace replay
@@ -0,0 +1,174 @@
+/*
+replay
+Software Library
+
+Copyright (c) 2010-2019 Marius Elvert
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+
+*/
+
+#include <replay/mapped_table.hpp>
+#include <system_error>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+#if defined(_WIN32)
+[[noreturn]] void throw_last_error(char const* what)
+{
+    throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), what);
+}
+
+/** Closes a handle when going out of scope. The mapped view stays valid after closing its file and mapping.
+ */
+struct handle_guard
+{
+    HANDLE handle;
+
+    ~handle_guard()
+    {
+        if (handle != nullptr && handle != INVALID_HANDLE_VALUE)
+            CloseHandle(handle);
+    }
+};
+#else
+[[noreturn]] void throw_last_error(char const* what)
+{
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+/** Closes a file descriptor when going out of scope. The mapping stays valid after closing the file.
+ */
+struct descriptor_guard
+{
+    int descriptor;
+
+    ~descriptor_guard()
+    {
+        if (descriptor != -1)
+            ::close(descriptor);
+    }
+};
+#endif
+
+} // namespace
+
+replay::mapped_file::mapped_file(std::filesystem::path const& filename, map_mode mode)
+: m_data(nullptr)
+, m_size(0)
+, m_mode(mode)
+{
+#if defined(_WIN32)
+    handle_guard file{ CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                   FILE_ATTRIBUTE_NORMAL, nullptr) };
+    if (file.handle == INVALID_HANDLE_VALUE)
+        throw_last_error("Unable to open file");
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file.handle, &size))
+        throw_last_error("Unable to query file size");
+
+    m_size = static_cast<std::size_t>(size.QuadPart);
+    if (m_size == 0)
+        return;
+
+    auto const protection = mode == map_mode::read_only ? PAGE_READONLY : PAGE_WRITECOPY;
+    handle_guard mapping{ CreateFileMappingW(file.handle, nullptr, protection, 0, 0, nullptr) };
+    if (mapping.handle == nullptr)
+        throw_last_error("Unable to create file mapping");
+
+    auto const access = mode == map_mode::read_only ? FILE_MAP_READ : FILE_MAP_COPY;
+    m_data = static_cast<char*>(MapViewOfFile(mapping.handle, access, 0, 0, 0));
+    if (m_data == nullptr)
+        throw_last_error("Unable to map file");
+#else
+    descriptor_guard file{ ::open(filename.c_str(), O_RDONLY) };
+    if (file.descriptor == -1)
+        throw_last_error("Unable to open file");
+
+    struct stat status;
+    if (::fstat(file.descriptor, &status) != 0)
+        throw_last_error("Unable to query file size");
+
+    m_size = static_cast<std::size_t>(status.st_size);
+    if (m_size == 0)
+        return;
+
+    // A private mapping of a read-only file can still be written to, the changes are just never written back
+    auto const protection = mode == map_mode::read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+    auto const data = ::mmap(nullptr, m_size, protection, MAP_PRIVATE, file.descriptor, 0);
+    if (data == MAP_FAILED)
+        throw_last_error("Unable to map file");
+
+    m_data = static_cast<char*>(data);
+#endif
+}
+
+replay::mapped_file::mapped_file(mapped_file&& rhs) noexcept
+: m_data(std::exchange(rhs.m_data, nullptr))
+, m_size(std::exchange(rhs.m_size, 0))
+, m_mode(rhs.m_mode)
+{
+}
+
+replay::mapped_file& replay::mapped_file::operator=(mapped_file&& rhs) noexcept
+{
+    if (&rhs == this)
+        return *this;
+
+    unmap();
+    m_data = std::exchange(rhs.m_data, nullptr);
+    m_size = std::exchange(rhs.m_size, 0);
+    m_mode = rhs.m_mode;
+    return *this;
+}
+
+replay::mapped_file::~mapped_file()
+{
+    unmap();
+}
+
+void replay::mapped_file::unmap() noexcept
+{
+    if (m_data == nullptr)
+        return;
+
+#if defined(_WIN32)
+    UnmapViewOfFile(m_data);
+#else
+    ::munmap(m_data, m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
@@ -0,0 +1,333 @@
+/*
+replay
+Software Library
+
+Copyright (c) 2010-2019 Marius Elvert
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+
+*/
+
+#include <cstdint>
+#include <replay/common.hpp>
+#include <replay/thread_pool.hpp>
+
+using replay::thread_pool;
+using replay::thread_pool_task;
+
+namespace
+{
+
+/** Chase-Lev work-stealing deque of task pointers.
+    Only the owning worker may push and take at the bottom, any thread may steal from the top.
+    Grown arrays are kept alive until destruction, since thieves might still read from them.
+ */
+class work_stealing_deque
+{
+public:
+    work_stealing_deque()
+    {
+        m_arrays.push_back(std::make_unique<ring>(256));
+        m_array.store(m_arrays.back().get(), std::memory_order_relaxed);
+    }
+
+    void push(thread_pool_task* task)
+    {
+        auto const bottom = m_bottom.load(std::memory_order_relaxed);
+        auto const top = m_top.load(std::memory_order_acquire);
+        auto array = m_array.load(std::memory_order_relaxed);
+
+        if (bottom - top >= static_cast<std::int64_t>(array->capacity))
+        {
+            m_arrays.push_back(array->grow(top, bottom));
+            array = m_arrays.back().get();
+            m_array.store(array, std::memory_order_release);
+        }
+
+        array->put(bottom, task);
+        m_bottom.store(bottom + 1, std::memory_order_release);
+    }
+
+    thread_pool_task* take()
+    {
+        auto const bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        auto const array = m_array.load(std::memory_order_relaxed);
+        m_bottom.store(bottom, std::memory_order_seq_cst);
+        auto top = m_top.load(std::memory_order_seq_cst);
+
+        if (top > bottom)
+        {
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        auto task = array->get(bottom);
+        if (top == bottom)
+        {
+            // Last element, race against thieves
+            if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                task = nullptr;
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return task;
+    }
+
+    thread_pool_task* steal()
+    {
+        auto top = m_top.load(std::memory_order_seq_cst);
+        auto const bottom = m_bottom.load(std::memory_order_seq_cst);
+        if (top >= bottom)
+            return nullptr;
+
+        auto const array = m_array.load(std::memory_order_acquire);
+        auto const task = array->get(top);
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+
+        return task;
+    }
+
+    /** Remove all remaining tasks. Must only be called when no other thread accesses the deque.
+     */
+    template <class Function> void drain(Function function)
+    {
+        while (auto task = take())
+            function(task);
+    }
+
+private:
+    struct ring
+    {
+        explicit ring(std::size_t capacity)
+        : capacity(capacity)
+        , mask(capacity - 1)
+        , slots(new std::atomic<thread_pool_task*>[capacity])
+        {
+        }
+
+        thread_pool_task* get(std::int64_t index) const
+        {
+            return slots[index & mask].load(std::memory_order_relaxed);
+        }
+
+        void put(std::int64_t index, thread_pool_task* task)
+        {
+            slots[index & mask].store(task, std::memory_order_relaxed);
+        }
+
+        std::unique_ptr<ring> grow(std::int64_t top, std::int64_t bottom) const
+        {
+            auto result = std::make_unique<ring>(capacity * 2);
+            for (auto i = top; i < bottom; ++i)
+                result->put(i, get(i));
+            return result;
+        }
+
+        std::size_t const capacity;
+        std::size_t const mask;
+        std::unique_ptr<std::atomic<thread_pool_task*>[]> slots;
+    };
+
+    alignas(replay::cache_line_size) std::atomic<std::int64_t> m_top{ 0 };
+    alignas(replay::cache_line_size) std::atomic<std::int64_t> m_bottom{ 0 };
+    std::atomic<ring*> m_array{ nullptr };
+    std::vector<std::unique_ptr<ring>> m_arrays;
+};
+
+} // namespace
+
+struct thread_pool::worker
+{
+    explicit worker(thread_pool& pool, std::size_t index)
+    : pool(pool)
+    , random_state(0x9E3779B97F4A7C15ull * (index + 1))
+    {
+    }
+
+    std::size_t next_random()
+    {
+        // xorshift64
+        random_state ^= random_state << 13;
+        random_state ^= random_state >> 7;
+        random_state ^= random_state << 17;
+        return static_cast<std::size_t>(random_state);
+    }
+
+    thread_pool& pool;
+    work_stealing_deque tasks;
+    std::uint64_t random_state;
+};
+
+thread_pool::thread_pool(std::size_t thread_count)
+{
+    if (thread_count == 0)
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+    for (std::size_t i = 0; i < thread_count; ++i)
+        m_workers.push_back(std::make_unique<worker>(*this, i));
+
+    for (auto& each : m_workers)
+        m_threads.emplace_back([this, &each] { worker_main(*each); });
+}
+
+thread_pool::~thread_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        m_stop.store(true);
+    }
+    m_wake_signal.notify_all();
+
+    for (auto& each : m_threads)
+        each.join();
+
+    auto const discard = [](thread_pool_task* task) { delete task; };
+    for (auto& each : m_workers)
+        each->tasks.drain(discard);
+    std::for_each(m_injection_queue.begin(), m_injection_queue.end(), discard);
+}
+
+std::size_t thread_pool::thread_count() const
+{
+    return m_threads.size();
+}
+
+void thread_pool::spawn(std::unique_ptr<thread_pool_task> task)
+{
+    if (auto self = current_worker())
+    {
+        self->tasks.push(task.release());
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(m_injection_mutex);
+        m_injection_queue.push_back(task.get());
+        task.release();
+    }
+
+    m_queued.fetch_add(1);
+    notify_task_available();
+}
+
+bool thread_pool::run_pending_task()
+{
+    std::unique_ptr<thread_pool_task> task(find_task(current_worker()));
+    if (!task)
+        return false;
+
+    task->execute();
+    return true;
+}
+
+thread_pool& thread_pool::shared()
+{
+    static thread_pool pool;
+    return pool;
+}
+
+thread_pool::worker*& thread_pool::current_thread_worker()
+{
+    thread_local worker* result = nullptr;
+    return result;
+}
+
+thread_pool::worker* thread_pool::current_worker()
+{
+    auto const self = current_thread_worker();
+    return (self != nullptr && &self->pool == this) ? self : nullptr;
+}
+
+void thread_pool::notify_task_available()
+{
+    if (m_sleeping.load() == 0)
+        return;
+
+    // Taking the lock makes sure a worker that is about to sleep either sees the new task or gets the signal
+    {
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+    }
+    m_wake_signal.notify_one();
+}
+
+thread_pool_task* thread_pool::find_task(worker* self)
+{
+    if (m_queued.load(std::memory_order_relaxed) == 0)
+        return nullptr;
+
+    thread_pool_task* task = nullptr;
+    if (self != nullptr)
+        task = self->tasks.take();
+
+    if (task == nullptr)
+    {
+        std::lock_guard<std::mutex> lock(m_injection_mutex);
+        if (!m_injection_queue.empty())
+        {
+            task = m_injection_queue.front();
+            m_injection_queue.pop_front();
+        }
+    }
+
+    if (task == nullptr)
+    {
+        auto const count = m_workers.size();
+        auto const start = self != nullptr ? self->next_random() : std::hash<std::thread::id>()(std::this_thread::get_id());
+        for (std::size_t i = 0; i < count && task == nullptr; ++i)
+        {
+            auto& victim = *m_workers[(start + i) % count];
+            if (&victim != self)
+                task = victim.tasks.steal();
+        }
+    }
+
+    if (task != nullptr)
+        m_queued.fetch_sub(1);
+
+    return task;
+}
+
+void thread_pool::worker_main(worker& self)
+{
+    current_thread_worker() = &self;
+
+    std::size_t idle_rounds = 0;
+    while (!m_stop.load(std::memory_order_relaxed))
+    {
+        if (run_pending_task())
+        {
+            idle_rounds = 0;
+            continue;
+        }
+
+        // Yield a few times before going to sleep, since new tasks tend to arrive in bursts
+        if (++idle_rounds < 64)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleep_mutex);
+        m_sleeping.fetch_add(1);
+        m_wake_signal.wait(lock, [this] { return m_stop.load() || m_queued.load() != 0; });
+        m_sleeping.fetch_sub(1);
+        idle_rounds = 0;
+    }
+
+    current_thread_worker() = nullptr;
+}
@@ -0,0 +1,140 @@
+#include <catch2/catch.hpp>
+#include <replay/async_queue.hpp>
+
+// Only testable when the compiler supports coroutines
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using replay::async_queue;
+
+namespace
+{
+
+struct detached_task
+{
+    struct promise_type
+    {
+        detached_task get_return_object()
+        {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never final_suspend() noexcept
+        {
+            return {};
+        }
+
+        void return_void()
+        {
+        }
+
+        void unhandled_exception()
+        {
+            std::terminate();
+        }
+    };
+};
+
+struct manual_executor
+{
+    void run()
+    {
+        while (!ready.empty())
+        {
+            auto handle = ready.front();
+            ready.pop_front();
+            handle.resume();
+        }
+    }
+
+    std::deque<std::coroutine_handle<>> ready;
+};
+
+detached_task consume(async_queue<std::string>& queue, std::vector<std::string>& output, int count)
+{
+    for (int i = 0; i < count; ++i)
+        output.push_back(co_await queue.pop());
+}
+
+detached_task produce(async_queue<std::string>& queue, std::vector<std::string> values)
+{
+    for (auto& each : values)
+        co_await queue.push(std::move(each));
+}
+
+} // namespace
+
+TEST_CASE("async_queue resumes a waiting consumer via the executor", "[async_queue]")
+{
+    manual_executor executor;
+    async_queue<std::string> queue([&](std::coroutine_handle<> handle) { executor.ready.push_back(handle); });
+
+    std::vector<std::string> output;
+    consume(queue, output, 2);
+    REQUIRE(output.empty());
+
+    std::string value = "first";
+    REQUIRE(queue.try_push(value));
+    REQUIRE(output.empty());
+    executor.run();
+    REQUIRE(output == std::vector<std::string>{ "first" });
+
+    value = "second";
+    REQUIRE(queue.try_push(value));
+    executor.run();
+    REQUIRE(output == std::vector<std::string>{ "first", "second" });
+}
+
+TEST_CASE("async_queue pop does not suspend when values are available", "[async_queue]")
+{
+    manual_executor executor;
+    async_queue<std::string> queue([&](std::coroutine_handle<> handle) { executor.ready.push_back(handle); });
+
+    REQUIRE(queue.try_push(std::string("ready")));
+
+    std::vector<std::string> output;
+    consume(queue, output, 1);
+    REQUIRE(output == std::vector<std::string>{ "ready" });
+}
+
+TEST_CASE("async_queue suspends producers while full", "[async_queue]")
+{
+    manual_executor executor;
+    async_queue<std::string> queue([&](std::coroutine_handle<> handle) { executor.ready.push_back(handle); }, 1);
+
+    produce(queue, { "a", "b", "c" });
+    REQUIRE(queue.size() == 1);
+
+    std::string extra = "d";
+    REQUIRE(!queue.try_push(extra));
+    REQUIRE(extra == "d");
+
+    std::vector<std::string> output;
+    while (output.size() < 3)
+    {
+        if (auto value = queue.try_pop())
+            output.push_back(*value);
+        executor.run();
+    }
+
+    REQUIRE(output == std::vector<std::string>{ "a", "b", "c" });
+    REQUIRE(queue.size() == 0);
+}
+
+TEST_CASE("async_queue rejects a size limit of zero", "[async_queue]")
+{
+    manual_executor executor;
+    auto schedule = [&](std::coroutine_handle<> handle) { executor.ready.push_back(handle); };
+    REQUIRE_THROWS_AS(async_queue<std::string>(schedule, 0), std::invalid_argument);
+}
+
+#endif
@@ -0,0 +1,84 @@
+#include <catch2/catch.hpp>
+#include <replay/chunked_grid.hpp>
+#include <numeric>
+#include <set>
+#include <utility>
+
+using namespace replay;
+
+TEST_CASE("chunked_grid reads the background without allocating", "[chunked_grid]")
+{
+    chunked_grid<int, 16> grid(-1);
+    REQUIRE(grid.get(100, -100000) == -1);
+    REQUIRE(grid.chunk_count() == 0);
+    grid.set(5, 5, -1);
+    REQUIRE(grid.chunk_count() == 0);
+}
+
+TEST_CASE("chunked_grid allocates chunks lazily in all directions", "[chunked_grid]")
+{
+    chunked_grid<int, 16> grid;
+    grid(0, 0) = 1;
+    grid(-1, 0) = 2;
+    grid(15, -1) = 3;
+    grid.set(-17, -33, 4);
+    REQUIRE(grid.chunk_count() == 4);
+    REQUIRE(grid.get(0, 0) == 1);
+    REQUIRE(grid.get(-1, 0) == 2);
+    REQUIRE(grid.get(15, -1) == 3);
+    REQUIRE(grid.get(-17, -33) == 4);
+    REQUIRE(grid.get(1, 0) == 0);
+}
+
+TEST_CASE("chunked_grid maps negative coordinates to the right chunk", "[chunked_grid]")
+{
+    using grid_type = chunked_grid<int, 16>;
+    REQUIRE(grid_type::chunk_of(-1, -16) == chunk_coordinate{ -1, -1 });
+    REQUIRE(grid_type::chunk_of(-17, 15) == chunk_coordinate{ -2, 0 });
+    REQUIRE(grid_type::chunk_of(16, 31) == chunk_coordinate{ 1, 1 });
+}
+
+TEST_CASE("chunked_grid evicts chunks that only contain the background", "[chunked_grid]")
+{
+    chunked_grid<int, 8> grid;
+    grid(3, 3) = 1;
+    grid(100, 100) = 2;
+    grid(3, 3) = 0;
+    REQUIRE(grid.evict_empty_chunks() == 1);
+    REQUIRE(grid.chunk_count() == 1);
+    REQUIRE(grid.get(100, 100) == 2);
+}
+
+TEST_CASE("chunked_grid iterates allocated chunks", "[chunked_grid]")
+{
+    chunked_grid<int, 8> grid;
+    grid(-5, 2) = 1;
+    grid(20, 2) = 1;
+
+    std::set<std::pair<std::int64_t, std::int64_t>> visited;
+    int sum = 0;
+    grid.for_each_chunk([&](chunk_coordinate const& coordinate, table<int> const& chunk) {
+        visited.emplace(coordinate.x, coordinate.y);
+        sum += std::accumulate(chunk.begin(), chunk.end(), 0);
+    });
+    REQUIRE(visited == std::set<std::pair<std::int64_t, std::int64_t>>{ { -1, 0 }, { 2, 0 } });
+    REQUIRE(sum == 2);
+}
+
+TEST_CASE("chunked_grid accessor looks up neighbors across chunk borders", "[chunked_grid]")
+{
+    chunked_grid<int, 4> grid;
+    for (std::int64_t y = -6; y < 6; ++y)
+        for (std::int64_t x = -6; x < 6; ++x)
+            grid(x, y) = static_cast<int>(x * 100 + y);
+
+    auto accessor = chunked_grid<int, 4>::const_accessor(grid);
+    bool all = true;
+    for (std::int64_t y = -5; y < 5; ++y)
+        for (std::int64_t x = -5; x < 5; ++x)
+            for (std::int64_t dy = -1; dy <= 1; ++dy)
+                for (std::int64_t dx = -1; dx <= 1; ++dx)
+                    all = all && accessor(x + dx, y + dy) == grid.get(x + dx, y + dy);
+    REQUIRE(all);
+    REQUIRE(accessor(1000, 1000) == 0);
+}
@@ -0,0 +1,94 @@
+#include <catch2/catch.hpp>
+#include <replay/concurrent_index_map.hpp>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using replay::concurrent_index_map;
+
+TEST_CASE("concurrent_index_map can insert and access below the capacity", "[concurrent_index_map]")
+{
+    concurrent_index_map<std::string> map(100);
+    REQUIRE(map.insert(42, "answer"));
+    REQUIRE(!map.insert(42, "other"));
+    REQUIRE(map.at(42) == "answer");
+    REQUIRE(map.size() == 1);
+    REQUIRE(!map.contains(41));
+}
+
+TEST_CASE("concurrent_index_map refuses keys beyond the capacity", "[concurrent_index_map]")
+{
+    concurrent_index_map<int> map(10);
+    REQUIRE_THROWS_AS(map.insert(10, 1), std::out_of_range);
+    REQUIRE(!map.contains(10));
+}
+
+TEST_CASE("concurrent_index_map keeps elements when reserving", "[concurrent_index_map]")
+{
+    concurrent_index_map<std::string> map(10);
+    map.insert(3, "three");
+    map.reserve(1000);
+    REQUIRE(map.capacity() == 1000);
+    REQUIRE(map.at(3) == "three");
+    REQUIRE(map.insert(999, "last"));
+}
+
+TEST_CASE("concurrent_index_map erase destructs the element", "[concurrent_index_map]")
+{
+    auto shared = std::make_shared<int>(0);
+    concurrent_index_map<std::shared_ptr<int>> map(8);
+    map.insert(1, shared);
+    REQUIRE(shared.use_count() == 2);
+    REQUIRE(map.erase(1));
+    REQUIRE(!map.erase(1));
+    REQUIRE(shared.use_count() == 1);
+    REQUIRE(map.empty());
+}
+
+TEST_CASE("concurrent_index_map can be filled from several threads", "[concurrent_index_map]")
+{
+    std::size_t const thread_count = 4;
+    std::size_t const key_count = 40000;
+    concurrent_index_map<std::size_t> map(key_count);
+
+    // Interleave keys, so threads share mask words
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < thread_count; ++t)
+    {
+        threads.emplace_back([&map, t] {
+            for (auto key = t; key < key_count; key += thread_count)
+                map.insert(key, key * 2);
+            for (auto key = t; key < key_count; key += 2 * thread_count)
+                map.erase(key);
+        });
+    }
+    for (auto& each : threads)
+        each.join();
+
+    REQUIRE(map.size() == key_count / 2);
+
+    bool all_correct = true;
+    std::size_t visited = 0;
+    map.for_each([&](std::size_t key, std::size_t value) {
+        all_correct = all_correct && value == key * 2 && (key % (2 * thread_count)) >= thread_count;
+        ++visited;
+    });
+    REQUIRE(all_correct);
+    REQUIRE(visited == key_count / 2);
+}
+
+TEST_CASE("concurrent_index_map can be move-assigned into an empty map", "[concurrent_index_map]")
+{
+    concurrent_index_map<int> target;
+    concurrent_index_map<int> source(128);
+    source.insert(3, 7);
+    target = std::move(source);
+    REQUIRE(target.size() == 1);
+    REQUIRE(target.at(3) == 7);
+    REQUIRE(source.size() == 0);
+
+    concurrent_index_map<int> empty;
+    target = std::move(empty);
+    REQUIRE(target.size() == 0);
+}
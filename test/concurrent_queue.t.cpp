@@ -0,0 +1,189 @@
+#include <catch2/catch.hpp>
+#include <replay/concurrent_queue.hpp>
+#include <chrono>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+using replay::concurrent_queue;
+
+TEST_CASE("concurrent_queue pops in fifo order", "[concurrent_queue]")
+{
+    concurrent_queue<std::string> queue;
+    queue.push("first");
+    queue.push("second");
+    REQUIRE(queue.pop() == "first");
+    REQUIRE(*queue.pop_optional() == "second");
+    REQUIRE(!queue.pop_optional());
+}
+
+TEST_CASE("concurrent_queue can push a range", "[concurrent_queue]")
+{
+    concurrent_queue<int> queue;
+    std::vector<int> const values{ 1, 2, 3 };
+    queue.push_range(values.begin(), values.end());
+    REQUIRE(queue.pop() == 1);
+    REQUIRE(queue.pop() == 2);
+    REQUIRE(queue.pop() == 3);
+}
+
+TEST_CASE("concurrent_queue pop_all moves everything out", "[concurrent_queue]")
+{
+    concurrent_queue<std::string> queue;
+    queue.push("a");
+    queue.push("b");
+
+    std::vector<std::string> result;
+    REQUIRE(queue.pop_all(std::back_inserter(result)) == 2);
+    REQUIRE(result == std::vector<std::string>{ "a", "b" });
+    REQUIRE(!queue.pop_optional());
+}
+
+TEST_CASE("concurrent_queue drain appends to a vector", "[concurrent_queue]")
+{
+    concurrent_queue<int> queue;
+    std::vector<int> result{ 0 };
+    REQUIRE(queue.drain(result) == 0);
+
+    queue.push(1);
+    queue.push(2);
+    REQUIRE(queue.drain(result) == 2);
+    REQUIRE(result == std::vector<int>{ 0, 1, 2 });
+}
+
+TEST_CASE("concurrent_queue drain unblocks a bounded push", "[concurrent_queue]")
+{
+    concurrent_queue<int> queue;
+    queue.push(1);
+
+    std::thread producer([&] { queue.push(2, 1); });
+
+    std::vector<int> result;
+    while (result.size() < 2)
+        queue.drain(result);
+
+    producer.join();
+    REQUIRE(result == std::vector<int>{ 1, 2 });
+}
+
+TEST_CASE("concurrent_queue pop_for times out on an empty queue", "[concurrent_queue]")
+{
+    concurrent_queue<int> queue;
+    REQUIRE(!queue.pop_for(std::chrono::milliseconds(1)));
+}
+
+TEST_CASE("concurrent_queue pop_until returns a value that is already there", "[concurrent_queue]")
+{
+    concurrent_queue<int> queue;
+    queue.push(7);
+    REQUIRE(*queue.pop_until(std::chrono::steady_clock::now()) == 7);
+}
+
+TEST_CASE("concurrent_queue push_for times out on a full queue and keeps the value", "[concurrent_queue]")
+{
+    concurrent_queue<std::string> queue;
+    queue.push("occupied");
+
+    std::string value = "new";
+    REQUIRE(!queue.push_for(std::move(value), 1, std::chrono::milliseconds(1)));
+    REQUIRE(value == "new");
+
+    queue.pop();
+    REQUIRE(queue.push_for(std::move(value), 1, std::chrono::milliseconds(1)));
+    REQUIRE(queue.pop() == "new");
+}
+
+TEST_CASE("concurrent_queue push_until copies lvalues only on success", "[concurrent_queue]")
+{
+    concurrent_queue<std::string> queue;
+    queue.push("occupied");
+
+    std::string const value = "new";
+    REQUIRE(!queue.push_until(value, 1, std::chrono::steady_clock::now()));
+    REQUIRE(queue.pop() == "occupied");
+
+    REQUIRE(queue.push_until(value, 1, std::chrono::steady_clock::now()));
+    REQUIRE(queue.push_for({ "braced" }, 2, std::chrono::milliseconds(1)));
+    REQUIRE(queue.pop() == "new");
+    REQUIRE(queue.pop() == "braced");
+    REQUIRE(!queue.pop_optional());
+    REQUIRE(value == "new");
+}
+
+TEST_CASE("concurrent_queue with spin policy transfers values between threads", "[concurrent_queue]")
+{
+    std::size_t const count = 10000;
+    concurrent_queue<std::size_t, replay::spin_then_block_wait<>> queue;
+
+    std::thread producer([&] {
+        for (std::size_t i = 0; i < count; ++i)
+            queue.push(i, 16);
+    });
+
+    bool in_order = true;
+    for (std::size_t i = 0; i < count; ++i)
+        in_order = queue.pop() == i && in_order;
+
+    producer.join();
+    REQUIRE(in_order);
+}
+
+TEST_CASE("concurrent_queue statistics count pushes, pops and depth", "[concurrent_queue]")
+{
+    concurrent_queue<int, replay::blocking_wait, replay::queue_statistics> queue;
+    std::vector<int> const values{ 1, 2, 3 };
+    queue.push_range(values.begin(), values.end());
+    queue.push(4);
+    queue.pop();
+
+    auto const statistics = queue.statistics();
+    REQUIRE(statistics.push_count == 4);
+    REQUIRE(statistics.pop_count == 1);
+    REQUIRE(statistics.depth == 3);
+    REQUIRE(statistics.high_water_mark == 4);
+    REQUIRE(statistics.blocked_pop_count == 0);
+}
+
+TEST_CASE("concurrent_queue statistics record waits", "[concurrent_queue]")
+{
+    concurrent_queue<int, replay::blocking_wait, replay::queue_statistics> queue;
+    std::thread consumer([&] { queue.pop(); });
+
+    // Only push once the consumer is blocked, so that it always has to wait
+    while (queue.statistics().waiting_pop_count == 0)
+        std::this_thread::yield();
+    queue.push(1);
+    consumer.join();
+
+    auto const statistics = queue.statistics();
+    REQUIRE(statistics.blocked_pop_count == 1);
+    REQUIRE(statistics.timed_out_pop_count == 0);
+    REQUIRE(statistics.waiting_pop_count == 0);
+
+    auto const& histogram = statistics.pop_wait_histogram;
+    REQUIRE(std::accumulate(histogram.begin(), histogram.end(), std::uint64_t{ 0 }) == 1);
+}
+
+TEST_CASE("concurrent_queue statistics record timed out waits", "[concurrent_queue]")
+{
+    concurrent_queue<int, replay::blocking_wait, replay::queue_statistics> queue;
+    REQUIRE(!queue.pop_for(std::chrono::milliseconds(1)));
+
+    queue.push(1);
+    int value = 2;
+    REQUIRE(!queue.push_for(std::move(value), 1, std::chrono::milliseconds(1)));
+
+    auto const statistics = queue.statistics();
+    REQUIRE(statistics.timed_out_pop_count == 1);
+    REQUIRE(statistics.blocked_pop_count == 1);
+    REQUIRE(statistics.timed_out_push_count == 1);
+    REQUIRE(statistics.blocked_push_count == 1);
+
+    // Both waits took at least the timeout, i.e. landed in the [512, 1024)us bucket or above
+    for (auto const& histogram : { statistics.pop_wait_histogram, statistics.push_wait_histogram })
+    {
+        REQUIRE(std::accumulate(histogram.begin(), histogram.end(), std::uint64_t{ 0 }) == 1);
+        REQUIRE(std::accumulate(histogram.begin(), histogram.begin() + 10, std::uint64_t{ 0 }) == 0);
+    }
+}
@@ -353,3 +353,138 @@ TEST_CASE("upsert()", "[index_map]")
         REQUIRE(many[11].value == 0.0);
     }
 }
+
+TEST_CASE("can iterate a sparse map spanning many mask words", "[index_map]")
+{
+    index_map<std::size_t> sparse;
+    std::vector<std::size_t> const keys{ 0, 63, 64, 1000, 4095, 70000 };
+    for (auto key : keys)
+        sparse.insert(key, key * 2);
+
+    std::vector<std::size_t> visited;
+    for (auto i = sparse.begin(), ie = sparse.end(); i != ie; ++i)
+        visited.push_back(i.key());
+
+    REQUIRE(visited == keys);
+}
+
+TEST_CASE("can iterate a sparse map backwards", "[index_map]")
+{
+    index_map<int> sparse;
+    sparse.insert(5, 1);
+    sparse.insert(700, 2);
+    sparse.insert(1300, 3);
+
+    auto i = sparse.end();
+    --i;
+    REQUIRE(i.key() == 1300);
+    --i;
+    REQUIRE(i.key() == 700);
+    --i;
+    REQUIRE(i.key() == 5);
+}
+
+TEST_CASE("erasing the last key finds the previous one across mask words", "[index_map]")
+{
+    index_map<int> sparse;
+    sparse.insert(3, 1);
+    sparse.insert(500, 2);
+    sparse.erase(500);
+    REQUIRE(sparse.smallest_key_bound() == 4);
+    sparse.erase(3);
+    REQUIRE(sparse.smallest_key_bound() == 0);
+}
+
+TEST_CASE("copy-constructed map has the same size", "[index_map]")
+{
+    auto const many = multi_element_sample();
+    auto const copy = many;
+    REQUIRE(copy.size() == many.size());
+    REQUIRE(copy == many);
+}
+
+TEST_CASE("remove_if visits every element of a sparse map", "[index_map]")
+{
+    index_map<std::size_t> sparse;
+    for (std::size_t key = 0; key < 10000; key += 37)
+        sparse.insert(key, key);
+
+    auto const size_before = sparse.size();
+    auto removed = sparse.remove_if([](std::size_t key, std::size_t) { return key % 2 == 0; });
+
+    REQUIRE(removed == (size_before + 1) / 2);
+    REQUIRE(sparse.size() == size_before - removed);
+    for (auto const& each : sparse)
+        REQUIRE(each % 2 == 1);
+}
+
+TEST_CASE("split_key_ranges covers the key space in word aligned ranges", "[index_map]")
+{
+    index_map<int> sparse;
+    sparse.insert(1, 1);
+    sparse.insert(300, 2);
+
+    auto const ranges = sparse.split_key_ranges(100);
+    REQUIRE(ranges.size() == 3);
+    REQUIRE(ranges[0].first == 0);
+    REQUIRE(ranges[0].last == 128);
+    REQUIRE(ranges[1].first == 128);
+    REQUIRE(ranges[1].last == 256);
+    REQUIRE(ranges[2].first == 256);
+    REQUIRE(ranges[2].last == 301);
+}
+
+TEST_CASE("for_each_in only visits keys in the range", "[index_map]")
+{
+    index_map<int> values;
+    for (int key : { 2, 10, 64, 65, 130 })
+        values.insert(key, key);
+
+    std::vector<std::size_t> visited;
+    values.for_each_in({ 3, 66 }, [&](std::size_t key, int) { visited.push_back(key); });
+    REQUIRE(visited == std::vector<std::size_t>{ 10, 64, 65 });
+}
+
+TEST_CASE("iterating past an erased last element reaches the old end", "[index_map]")
+{
+    index_map<int> values;
+    values.insert(3, 1);
+    values.insert(9, 2);
+
+    std::size_t visited = 0;
+    for (auto i = values.begin(), ie = values.end(); i != ie; ++i)
+    {
+        values.erase(i);
+        ++visited;
+    }
+
+    REQUIRE(visited == 2);
+    REQUIRE(values.empty());
+}
+
+TEST_CASE("growing a map of trivially copyable values keeps them", "[index_map]")
+{
+    index_map<sample_payload> values;
+    for (std::size_t key = 0; key < 5000; key += 7)
+        values.insert(key, sample_payload{ static_cast<std::uint8_t>(key), key * 0.5 });
+
+    auto const copy = values;
+    REQUIRE(copy == values);
+    REQUIRE(copy.size() == values.size());
+
+    bool all_kept = true;
+    for (auto i = copy.begin(), ie = copy.end(); i != ie; ++i)
+        all_kept = all_kept && i->value == i.key() * 0.5 && i->key == static_cast<std::uint8_t>(i.key());
+    REQUIRE(all_kept);
+}
+
+TEST_CASE("growing a map of non-trivial values keeps them", "[index_map]")
+{
+    index_map<std::string> values;
+    for (std::size_t key = 0; key < 500; key += 3)
+        values.insert(key, std::to_string(key));
+
+    auto const copy = values;
+    REQUIRE(copy == values);
+    REQUIRE(copy.at(498) == "498");
+}
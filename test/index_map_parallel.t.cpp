@@ -0,0 +1,29 @@
+#include <catch2/catch.hpp>
+#include <replay/index_map_parallel.hpp>
+
+using replay::index_map;
+
+TEST_CASE("parallel_for_each visits every element once", "[index_map]")
+{
+    replay::thread_pool pool(3);
+    index_map<std::size_t> values;
+    for (std::size_t key = 0; key < 50000; key += 3)
+        values.insert(key, 0);
+
+    replay::parallel_for_each(pool, values, [](std::size_t key, std::size_t& value) { value += key + 1; }, 64);
+
+    for (auto i = values.begin(), ie = values.end(); i != ie; ++i)
+        REQUIRE(*i == i.key() + 1);
+}
+
+TEST_CASE("parallel_for_each on the shared pool visits every element once", "[index_map]")
+{
+    index_map<std::size_t> values;
+    for (std::size_t key = 0; key < 20000; key += 7)
+        values.insert(key, 0);
+
+    replay::parallel_for_each(values, [](std::size_t key, std::size_t& value) { value += key + 1; }, 256);
+
+    for (auto i = values.begin(), ie = values.end(); i != ie; ++i)
+        REQUIRE(*i == i.key() + 1);
+}
@@ -0,0 +1,100 @@
+#include <catch2/catch.hpp>
+#include <replay/mapped_table.hpp>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+using namespace replay;
+
+namespace
+{
+/** Temporary file that is deleted when going out of scope.
+ */
+struct temporary_file
+{
+    explicit temporary_file(char const* name)
+    : path(std::filesystem::temp_directory_path() / name)
+    {
+    }
+
+    ~temporary_file()
+    {
+        std::error_code error;
+        std::filesystem::remove(path, error);
+    }
+
+    std::filesystem::path path;
+};
+
+table<float> make_heights(std::size_t w, std::size_t h)
+{
+    table<float> result(w, h);
+    for (std::size_t y = 0; y < h; ++y)
+        for (std::size_t x = 0; x < w; ++x)
+            result(x, y) = static_cast<float>(y * w + x) * 0.25f;
+    return result;
+}
+} // namespace
+
+TEST_CASE("mapped_table reads a saved table", "[mapped_table]")
+{
+    temporary_file file("replay_mapped_table_read.bin");
+    auto const heights = make_heights(37, 19);
+    save_mapped_table(file.path, heights);
+
+    mapped_table<float> mapped(file.path);
+    REQUIRE(mapped.width() == 37);
+    REQUIRE(mapped.height() == 19);
+    REQUIRE(mapped(0, 0) == 0.f);
+    REQUIRE(mapped(36, 18) == heights(36, 18));
+    REQUIRE(std::equal(heights.begin(), heights.end(), mapped.ptr()));
+    REQUIRE(reinterpret_cast<std::uintptr_t>(mapped.ptr()) % 64 == 0);
+}
+
+TEST_CASE("copy-on-write mapped_table does not change the file", "[mapped_table]")
+{
+    temporary_file file("replay_mapped_table_cow.bin");
+    save_mapped_table(file.path, table<int>(8, 8, 3));
+
+    {
+        mapped_table<int, map_mode::copy_on_write> mapped(file.path);
+        mapped(2, 5) = 42;
+        mapped.view().subview(0, 0, 2, 2).fill(7);
+        REQUIRE(mapped(2, 5) == 42);
+        REQUIRE(mapped(1, 1) == 7);
+    }
+
+    mapped_table<int> reopened(file.path);
+    REQUIRE(reopened(2, 5) == 3);
+    REQUIRE(reopened(1, 1) == 3);
+}
+
+TEST_CASE("mapped_table can save a sub-region", "[mapped_table]")
+{
+    temporary_file file("replay_mapped_table_region.bin");
+    auto heights = make_heights(10, 10);
+    save_mapped_table(file.path, const_table_view<float>(heights).subview(2, 3, 4, 5));
+
+    mapped_table<float> mapped(file.path);
+    REQUIRE(mapped.width() == 4);
+    REQUIRE(mapped.height() == 5);
+    REQUIRE(mapped(3, 4) == heights(5, 7));
+}
+
+TEST_CASE("mapped_table rejects invalid files", "[mapped_table]")
+{
+    temporary_file file("replay_mapped_table_invalid.bin");
+    {
+        std::ofstream stream(file.path, std::ios_base::binary);
+        stream << "this is not a table file, but it is long enough for a header to be read from it...";
+    }
+    REQUIRE_THROWS_AS(mapped_table<float>(file.path), mapped_table_format_error);
+
+    save_mapped_table(file.path, table<float>(4, 4, 0.f));
+    REQUIRE_THROWS_AS(mapped_table<double>(file.path), mapped_table_format_error);
+
+    std::filesystem::resize_file(file.path, 64 + 15 * sizeof(float));
+    REQUIRE_THROWS_AS(mapped_table<float>(file.path), mapped_table_format_error);
+
+    REQUIRE_THROWS_AS(mapped_table<float>(file.path.string() + ".missing"), std::system_error);
+}
@@ -0,0 +1,165 @@
+#include <catch2/catch.hpp>
+#include <replay/mpmc_queue.hpp>
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using replay::mpmc_queue;
+
+TEST_CASE("mpmc_queue rounds capacity up to a power of two", "[mpmc_queue]")
+{
+    REQUIRE(mpmc_queue<int>(5).capacity() == 8);
+    REQUIRE(mpmc_queue<int>(1).capacity() == 2);
+}
+
+TEST_CASE("mpmc_queue rejects capacities without a power of two to round up to", "[mpmc_queue]")
+{
+    REQUIRE_THROWS_AS(mpmc_queue<int>(0), std::invalid_argument);
+    REQUIRE_THROWS_AS(mpmc_queue<int>(std::numeric_limits<std::size_t>::max() / 2 + 2), std::length_error);
+}
+
+TEST_CASE("mpmc_queue pops in fifo order", "[mpmc_queue]")
+{
+    mpmc_queue<std::string> queue(4);
+    queue.push("first");
+    queue.push("second");
+    REQUIRE(queue.size() == 2);
+    REQUIRE(queue.pop() == "first");
+    REQUIRE(*queue.try_pop() == "second");
+    REQUIRE(!queue.try_pop());
+}
+
+TEST_CASE("mpmc_queue try_push fails when full", "[mpmc_queue]")
+{
+    mpmc_queue<int> queue(2);
+    REQUIRE(queue.try_push(1));
+    REQUIRE(queue.try_push(2));
+    REQUIRE(!queue.try_push(3));
+    REQUIRE(queue.pop() == 1);
+    REQUIRE(queue.try_push(3));
+    REQUIRE(queue.pop() == 2);
+    REQUIRE(queue.pop() == 3);
+}
+
+TEST_CASE("mpmc_queue destructs remaining elements", "[mpmc_queue]")
+{
+    auto shared = std::make_shared<int>(42);
+    {
+        mpmc_queue<std::shared_ptr<int>> queue(4);
+        queue.push(shared);
+        queue.push(shared);
+        REQUIRE(shared.use_count() == 3);
+    }
+    REQUIRE(shared.use_count() == 1);
+}
+
+TEST_CASE("mpmc_queue skips slots whose construction threw", "[mpmc_queue]")
+{
+    struct fragile
+    {
+        explicit fragile(int value)
+        : value(value)
+        {
+            if (value < 0)
+                throw std::runtime_error("construction failed");
+        }
+
+        int value;
+    };
+
+    mpmc_queue<fragile> queue(2);
+    for (int lap = 0; lap < 3; ++lap)
+    {
+        REQUIRE_THROWS_AS(queue.try_push(-1), std::runtime_error);
+        REQUIRE(queue.try_push(lap));
+        REQUIRE(queue.try_pop()->value == lap);
+        REQUIRE(!queue.try_pop());
+    }
+
+    REQUIRE_THROWS_AS(queue.try_push(-1), std::runtime_error);
+    REQUIRE(!queue.try_pop());
+    REQUIRE(queue.try_push(7));
+    REQUIRE(queue.try_push(8));
+    REQUIRE(queue.pop().value == 7);
+    REQUIRE(queue.pop().value == 8);
+}
+
+TEST_CASE("mpmc_queue releases slots whose value throws when moved out", "[mpmc_queue]")
+{
+    struct fragile
+    {
+        explicit fragile(int value)
+        : value(value)
+        {
+        }
+
+        fragile(fragile const&) = default;
+
+        fragile(fragile&& rhs)
+        : value(rhs.value)
+        {
+            if (value < 0)
+                throw std::runtime_error("move failed");
+        }
+
+        int value;
+    };
+
+    mpmc_queue<fragile> queue(2);
+    for (int lap = 0; lap < 3; ++lap)
+    {
+        fragile const poisoned(-1);
+        REQUIRE(queue.try_push(poisoned));
+        REQUIRE_THROWS_AS(queue.try_pop(), std::runtime_error);
+
+        fragile const healthy(lap);
+        REQUIRE(queue.try_push(healthy));
+        REQUIRE(queue.try_pop()->value == lap);
+        REQUIRE(!queue.try_pop());
+    }
+}
+
+TEST_CASE("mpmc_queue transfers every value exactly once between many threads", "[mpmc_queue]")
+{
+    std::size_t const thread_count = 4;
+    std::size_t const count_per_thread = 20000;
+    mpmc_queue<std::size_t> queue(64);
+
+    std::vector<std::thread> producers;
+    for (std::size_t t = 0; t < thread_count; ++t)
+    {
+        producers.emplace_back([&queue, t] {
+            for (std::size_t i = 0; i < count_per_thread; ++i)
+                queue.push(t * count_per_thread + i);
+        });
+    }
+
+    std::vector<std::vector<std::size_t>> received(thread_count);
+    std::vector<std::thread> consumers;
+    for (std::size_t t = 0; t < thread_count; ++t)
+    {
+        consumers.emplace_back([&queue, &received, t] {
+            for (std::size_t i = 0; i < count_per_thread; ++i)
+                received[t].push_back(queue.pop());
+        });
+    }
+
+    for (auto& each : producers)
+        each.join();
+    for (auto& each : consumers)
+        each.join();
+
+    std::vector<std::size_t> all;
+    for (auto const& each : received)
+        all.insert(all.end(), each.begin(), each.end());
+    std::sort(all.begin(), all.end());
+
+    std::vector<std::size_t> expected(thread_count * count_per_thread);
+    std::iota(expected.begin(), expected.end(), std::size_t{ 0 });
+    REQUIRE(all == expected);
+}
@@ -0,0 +1,161 @@
+#include <catch2/catch.hpp>
+#include <replay/multi_index_map.hpp>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using replay::multi_index_map;
+
+namespace
+{
+using entity_map = multi_index_map<float, int, std::string>;
+
+entity_map sample()
+{
+    entity_map map;
+    map.insert(3, 1.5f, 10, "three");
+    map.insert(70, 2.5f, 20, "seventy");
+    map.insert(200, 3.5f, 30, "two hundred");
+    return map;
+}
+} // namespace
+
+TEST_CASE("multi_index_map can access all columns of an element", "[multi_index_map]")
+{
+    auto map = sample();
+    REQUIRE(map.size() == 3);
+    auto [x, health, name] = map.at(70);
+    REQUIRE(x == 2.5f);
+    REQUIRE(health == 20);
+    REQUIRE(name == "seventy");
+    REQUIRE(map.get<2>(200) == "two hundred");
+}
+
+TEST_CASE("multi_index_map does not overwrite on insert", "[multi_index_map]")
+{
+    auto map = sample();
+    REQUIRE(!map.insert(3, 0.f, 0, "other"));
+    REQUIRE(map.get<2>(3) == "three");
+}
+
+TEST_CASE("multi_index_map can update through the reference tuple", "[multi_index_map]")
+{
+    auto map = sample();
+    std::get<1>(map[3]) = 99;
+    REQUIRE(map.get<1>(3) == 99);
+}
+
+TEST_CASE("multi_index_map erase removes all columns", "[multi_index_map]")
+{
+    auto shared = std::make_shared<int>(0);
+    multi_index_map<int, std::shared_ptr<int>> map;
+    map.insert(5, 1, shared);
+    map.erase(5);
+    REQUIRE(shared.use_count() == 1);
+    REQUIRE(map.empty());
+    REQUIRE(!map.contains(5));
+    REQUIRE_THROWS_AS(map.at(5), std::out_of_range);
+}
+
+TEST_CASE("multi_index_map iterates tuples in key order", "[multi_index_map]")
+{
+    auto const map = sample();
+    std::vector<std::string> names;
+    std::vector<std::size_t> keys;
+    for (auto i = map.begin(), ie = map.end(); i != ie; ++i)
+    {
+        keys.push_back(i.key());
+        names.push_back(std::get<2>(*i));
+    }
+    REQUIRE(keys == std::vector<std::size_t>{ 3, 70, 200 });
+    REQUIRE(names == std::vector<std::string>{ "three", "seventy", "two hundred" });
+}
+
+TEST_CASE("multi_index_map can iterate a single column", "[multi_index_map]")
+{
+    auto map = sample();
+    map.for_each_in_column<0>([](std::size_t, float& x) { x *= 2.f; });
+
+    float sum = 0.f;
+    map.for_each([&](std::size_t, float x, int, std::string const&) { sum += x; });
+    REQUIRE(sum == 15.f);
+    REQUIRE(map.column<0>()[200] == 7.f);
+}
+
+TEST_CASE("multi_index_map keeps values when growing and copying", "[multi_index_map]")
+{
+    entity_map map;
+    for (std::size_t key = 0; key < 1000; key += 9)
+        map.insert(key, key * 0.5f, static_cast<int>(key), std::to_string(key));
+
+    auto const copy = map;
+    REQUIRE(copy.size() == map.size());
+
+    bool all_kept = true;
+    copy.for_each([&](std::size_t key, float x, int health, std::string const& name) {
+        all_kept = all_kept && x == key * 0.5f && health == static_cast<int>(key) && name == std::to_string(key);
+    });
+    REQUIRE(all_kept);
+}
+
+TEST_CASE("multi_index_map erase shrinks the key bound past empty mask words", "[multi_index_map]")
+{
+    multi_index_map<int> map;
+    map.insert(3, 3);
+    map.insert(70, 70);
+    map.insert(300, 300);
+
+    map.erase(300);
+    REQUIRE(map.smallest_key_bound() == 71);
+    map.erase(70);
+    REQUIRE(map.smallest_key_bound() == 4);
+    map.erase(3);
+    REQUIRE(map.smallest_key_bound() == 0);
+}
+
+namespace
+{
+struct copy_counted
+{
+    static int alive;
+    static int copies_until_failure;
+
+    copy_counted()
+    {
+        ++alive;
+    }
+
+    copy_counted(copy_counted const&)
+    {
+        if (copies_until_failure-- == 0)
+            throw std::runtime_error("copy failed");
+        ++alive;
+    }
+
+    ~copy_counted()
+    {
+        --alive;
+    }
+};
+
+int copy_counted::alive = 0;
+int copy_counted::copies_until_failure = -1;
+} // namespace
+
+TEST_CASE("multi_index_map cleans up a copy that throws", "[multi_index_map]")
+{
+    using counted_map = multi_index_map<copy_counted, std::string>;
+    {
+        counted_map map;
+        for (std::size_t key = 0; key < 10; ++key)
+            map.insert(key * 7, copy_counted{}, std::to_string(key));
+        REQUIRE(copy_counted::alive == 10);
+
+        copy_counted::copies_until_failure = 4;
+        REQUIRE_THROWS_AS(counted_map{ map }, std::runtime_error);
+        copy_counted::copies_until_failure = -1;
+        REQUIRE(copy_counted::alive == 10);
+    }
+    REQUIRE(copy_counted::alive == 0);
+}
@@ -0,0 +1,101 @@
+#include <catch2/catch.hpp>
+#include <replay/mutable_rle_vector.hpp>
+#include <vector>
+
+using namespace replay;
+
+namespace
+{
+template <class T> std::vector<T> expand(mutable_rle_vector<T> const& v)
+{
+    std::vector<T> result;
+    v.for_each_run([&](std::size_t, std::size_t count, T const& value) { result.insert(result.end(), count, value); });
+    return result;
+}
+} // namespace
+
+TEST_CASE("mutable_rle_vector can set a single element")
+{
+    mutable_rle_vector<int> v(10, 0);
+    v.set(4, 1);
+    REQUIRE(v.size() == 10);
+    REQUIRE(v.run_count() == 3);
+    REQUIRE(expand(v) == std::vector<int>{ 0, 0, 0, 0, 1, 0, 0, 0, 0, 0 });
+    REQUIRE(v[4] == 1);
+    REQUIRE(v.at(5) == 0);
+}
+
+TEST_CASE("mutable_rle_vector merges neighboring runs with equal values")
+{
+    mutable_rle_vector<int> v(10, 0);
+    v.set(4, 1);
+    v.set(4, 0);
+    REQUIRE(v.run_count() == 1);
+    REQUIRE(v == mutable_rle_vector<int>(10, 0));
+
+    v.assign_range(2, 3, 5);
+    v.assign_range(5, 2, 5);
+    REQUIRE(v.run_count() == 3);
+    REQUIRE(expand(v) == std::vector<int>{ 0, 0, 5, 5, 5, 5, 5, 0, 0, 0 });
+}
+
+TEST_CASE("mutable_rle_vector can overwrite several runs")
+{
+    mutable_rle_vector<int> v(rle_vector<int>{ { 1, 2 }, { 2, 2 }, { 3, 2 }, { 4, 2 } });
+    v.assign_range(1, 6, 9);
+    REQUIRE(expand(v) == std::vector<int>{ 1, 9, 9, 9, 9, 9, 9, 4 });
+    v.assign_range(0, 8, 7);
+    REQUIRE(v.run_count() == 1);
+}
+
+TEST_CASE("mutable_rle_vector assigns at the ends")
+{
+    mutable_rle_vector<int> v(4, 0);
+    v.set(0, 1);
+    v.set(3, 2);
+    REQUIRE(expand(v) == std::vector<int>{ 1, 0, 0, 2 });
+    REQUIRE_THROWS_AS(v.set(4, 1), std::out_of_range);
+    REQUIRE_THROWS_AS(v.assign_range(2, 3, 1), std::out_of_range);
+}
+
+TEST_CASE("mutable_rle_vector push merges equal values")
+{
+    mutable_rle_vector<int> v;
+    v.push(1, 2);
+    v.push(1, 3);
+    v.push(2);
+    REQUIRE(v.run_count() == 2);
+    REQUIRE(v.to_rle_vector() == rle_vector<int>{ { 1, 5 }, { 2, 1 } });
+}
+
+TEST_CASE("mutable_rle_vector matches a plain vector under random assignments")
+{
+    std::size_t const size = 200;
+    mutable_rle_vector<int> v(size, 0);
+    std::vector<int> reference(size, 0);
+
+    std::uint32_t state = 777;
+    auto next = [&] {
+        state = state * 1664525u + 1013904223u;
+        return state >> 8;
+    };
+
+    for (int step = 0; step < 2000; ++step)
+    {
+        auto const first = next() % size;
+        auto const count = next() % (size - first + 1);
+        auto const value = static_cast<int>(next() % 3);
+        v.assign_range(first, count, value);
+        std::fill_n(reference.begin() + first, count, value);
+    }
+
+    REQUIRE(expand(v) == reference);
+
+    bool merged = true;
+    int previous = -1;
+    v.for_each_run([&](std::size_t, std::size_t, int value) {
+        merged = merged && value != previous;
+        previous = value;
+    });
+    REQUIRE(merged);
+}
@@ -0,0 +1,251 @@
+#include <catch2/catch.hpp>
+#include <replay/paged_index_map.hpp>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using replay::paged_index_map;
+
+namespace
+{
+using small_map = paged_index_map<std::string, 128>;
+
+small_map multi_element_sample()
+{
+    small_map map;
+    for (auto const& each : { 3, 130, 131, 50000000 })
+        map.insert(each, std::to_string(each));
+    return map;
+}
+} // namespace
+
+TEST_CASE("paged_index_map starts out empty", "[paged_index_map]")
+{
+    small_map map;
+    REQUIRE(map.empty());
+    REQUIRE(map.begin() == map.end());
+    REQUIRE(map.allocated_page_count() == 0);
+}
+
+TEST_CASE("paged_index_map only allocates pages that are used", "[paged_index_map]")
+{
+    auto map = multi_element_sample();
+    REQUIRE(map.size() == 4);
+    REQUIRE(map.allocated_page_count() == 3);
+    REQUIRE(map.smallest_key_bound() == 50000001);
+    REQUIRE(map.at(50000000) == "50000000");
+}
+
+TEST_CASE("paged_index_map frees pages when they become empty", "[paged_index_map]")
+{
+    auto map = multi_element_sample();
+    map.erase(130);
+    REQUIRE(map.allocated_page_count() == 3);
+    map.erase(131);
+    REQUIRE(map.allocated_page_count() == 2);
+    map.erase(50000000);
+    REQUIRE(map.allocated_page_count() == 1);
+    REQUIRE(map.smallest_key_bound() == 4);
+}
+
+TEST_CASE("paged_index_map handles huge keys without a dense directory", "[paged_index_map]")
+{
+    auto const huge = std::size_t{ 1 } << 44;
+    small_map map;
+    map.insert(huge, "huge");
+    map.insert(huge + 200, "huger");
+    map.insert(5, "small");
+    REQUIRE(map.allocated_page_count() == 3);
+    REQUIRE(map.at(huge) == "huge");
+
+    std::vector<std::size_t> keys;
+    for (auto it = map.begin(); it != map.end(); ++it)
+        keys.push_back(it.key());
+    REQUIRE(keys == std::vector<std::size_t>{ 5, huge, huge + 200 });
+
+    map.erase(huge + 200);
+    REQUIRE(map.smallest_key_bound() == huge + 1);
+    map.erase(huge);
+    REQUIRE(map.allocated_page_count() == 1);
+    REQUIRE(map.smallest_key_bound() == 6);
+}
+
+TEST_CASE("paged_index_map releases a new page when constructing its first value throws", "[paged_index_map]")
+{
+    struct fragile
+    {
+        fragile(int value) // Implicit, so that upsert can assign from int
+        : value(value)
+        {
+            if (value < 0)
+                throw std::runtime_error("construction failed");
+        }
+
+        bool operator==(fragile const& rhs) const
+        {
+            return value == rhs.value;
+        }
+
+        int value;
+    };
+
+    paged_index_map<fragile, 64> map;
+    map.insert(1, 1);
+    auto const before = map;
+
+    REQUIRE_THROWS_AS(map.insert(500, -1), std::runtime_error);
+    REQUIRE_THROWS_AS(map.upsert(700, -1), std::runtime_error);
+    REQUIRE_THROWS_AS(map.insert(2, -1), std::runtime_error);
+    REQUIRE(map.allocated_page_count() == 1);
+    REQUIRE(map.size() == 1);
+    REQUIRE(map == before);
+}
+
+TEST_CASE("paged_index_map iterators are ordered by key", "[paged_index_map]")
+{
+    auto map = multi_element_sample();
+    auto first = map.begin();
+    auto second = std::next(first);
+    auto const& const_map = map;
+    REQUIRE(first < second);
+    REQUIRE(second > first);
+    REQUIRE(first <= const_map.begin());
+    REQUIRE(map.end() >= second);
+    REQUIRE(!(second < first));
+}
+
+TEST_CASE("paged_index_map iterates in key order", "[paged_index_map]")
+{
+    auto map = multi_element_sample();
+    std::vector<std::size_t> keys;
+    for (auto i = map.begin(), ie = map.end(); i != ie; ++i)
+        keys.push_back(i.key());
+    REQUIRE(keys == std::vector<std::size_t>{ 3, 130, 131, 50000000 });
+
+    auto i = map.end();
+    --i;
+    REQUIRE(i.key() == 50000000);
+    --i;
+    REQUIRE(i.key() == 131);
+    --i;
+    REQUIRE(i.key() == 130);
+    --i;
+    REQUIRE(i.key() == 3);
+}
+
+TEST_CASE("paged_index_map insert does not overwrite but upsert does", "[paged_index_map]")
+{
+    auto map = multi_element_sample();
+    map.insert(3, "other");
+    REQUIRE(map[3] == "3");
+    map.upsert(3, "other");
+    REQUIRE(map[3] == "other");
+    map.upsert(7, "new");
+    REQUIRE(map.size() == 5);
+}
+
+TEST_CASE("paged_index_map at throws for missing keys", "[paged_index_map]")
+{
+    auto map = multi_element_sample();
+    REQUIRE_THROWS_AS(map.at(4), std::out_of_range);
+    REQUIRE_THROWS_AS(map.at(100000000), std::out_of_range);
+}
+
+TEST_CASE("paged_index_map copies compare equal", "[paged_index_map]")
+{
+    auto const map = multi_element_sample();
+    auto copy = map;
+    REQUIRE(copy == map);
+    copy.upsert(131, "changed");
+    REQUIRE(copy != map);
+}
+
+TEST_CASE("paged_index_map destructs its elements", "[paged_index_map]")
+{
+    auto shared = std::make_shared<int>(0);
+    {
+        paged_index_map<std::shared_ptr<int>, 64> map;
+        map.insert(5, shared);
+        map.insert(1000, shared);
+        map.erase(5);
+        REQUIRE(shared.use_count() == 2);
+    }
+    REQUIRE(shared.use_count() == 1);
+}
+
+TEST_CASE("paged_index_map remove_if erases matching elements", "[paged_index_map]")
+{
+    auto map = multi_element_sample();
+    auto removed = map.remove_if([](std::size_t key, std::string const&) { return key > 100; });
+    REQUIRE(removed == 3);
+    REQUIRE(map.size() == 1);
+    REQUIRE(map.allocated_page_count() == 1);
+}
+
+TEST_CASE("cow_index_map copies share all pages", "[paged_index_map]")
+{
+    replay::cow_index_map<std::string, 128> map;
+    for (auto const& each : { 3, 130, 131, 50000000 })
+        map.insert(each, std::to_string(each));
+
+    auto const snapshot = map;
+    REQUIRE(map.shared_page_count() == 3);
+    REQUIRE(snapshot == map);
+}
+
+TEST_CASE("cow_index_map writes only clone the touched page", "[paged_index_map]")
+{
+    replay::cow_index_map<std::string, 128> map;
+    for (auto const& each : { 3, 130, 131, 50000000 })
+        map.insert(each, std::to_string(each));
+
+    auto const snapshot = map;
+    map.upsert(130, "changed");
+    REQUIRE(map.shared_page_count() == 2);
+    REQUIRE(snapshot.at(130) == "130");
+    REQUIRE(map.at(130) == "changed");
+
+    map.at(3) = "also changed";
+    map.erase(50000000);
+    REQUIRE(map.shared_page_count() == 0);
+    REQUIRE(snapshot.at(3) == "3");
+    REQUIRE(snapshot.at(50000000) == "50000000");
+    REQUIRE(snapshot.size() == 4);
+    REQUIRE(map.size() == 3);
+}
+
+TEST_CASE("cow_index_map does not clone pages for writes that change nothing", "[paged_index_map]")
+{
+    replay::cow_index_map<int, 64> map;
+    map.insert(3, 3);
+    map.insert(100, 100);
+
+    auto const snapshot = map;
+    REQUIRE(map.shared_page_count() == 2);
+
+    map.insert(3, 9);
+    REQUIRE(map.shared_page_count() == 2);
+    REQUIRE(std::as_const(map).at(3) == 3);
+
+    map.erase(100);
+    REQUIRE(map.shared_page_count() == 1);
+    REQUIRE(map.allocated_page_count() == 1);
+    REQUIRE(snapshot.shared_page_count() == 1);
+    REQUIRE(snapshot.at(100) == 100);
+}
+
+TEST_CASE("cow_index_map snapshots survive mutable iteration", "[paged_index_map]")
+{
+    replay::cow_index_map<int, 64> map;
+    for (int key = 0; key < 200; key += 5)
+        map.insert(key, key);
+
+    auto const snapshot = map;
+    for (auto& each : map)
+        each = -each;
+
+    REQUIRE(snapshot.at(195) == 195);
+    REQUIRE(map.at(195) == -195);
+}
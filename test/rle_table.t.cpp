@@ -0,0 +1,75 @@
+#include <catch2/catch.hpp>
+#include <replay/rle_table.hpp>
+#include <cstdint>
+
+using namespace replay;
+
+namespace
+{
+template <class T> bool tables_equal(table<T> const& lhs, table<T> const& rhs)
+{
+    return lhs.width() == rhs.width() && lhs.height() == rhs.height() &&
+           std::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+} // namespace
+
+TEST_CASE("rle_table of a uniform value has one run per row")
+{
+    rle_table<std::uint8_t> t(4096, 16, 3);
+    REQUIRE(t.width() == 4096);
+    REQUIRE(t.height() == 16);
+    REQUIRE(t.run_count() == 16);
+    REQUIRE(t(4000, 15) == 3);
+}
+
+TEST_CASE("rle_table can fill a rectangle")
+{
+    rle_table<int> t(8, 6, 0);
+    t.fill_rect(2, 1, 3, 2, 7);
+    REQUIRE(t(1, 1) == 0);
+    REQUIRE(t(2, 1) == 7);
+    REQUIRE(t(4, 2) == 7);
+    REQUIRE(t(5, 2) == 0);
+    REQUIRE(t(3, 3) == 0);
+    REQUIRE(t.row(1) == rle_vector<int>{ { 0, 2 }, { 7, 3 }, { 0, 3 } });
+    REQUIRE_THROWS_AS(t.fill_rect(6, 0, 3, 1, 1), std::out_of_range);
+}
+
+TEST_CASE("rle_table merges runs when filling")
+{
+    rle_table<int> t(8, 1, 0);
+    t.fill_rect(2, 0, 2, 1, 7);
+    t.fill_rect(4, 0, 4, 1, 7);
+    REQUIRE(t.row(0) == rle_vector<int>{ { 0, 2 }, { 7, 6 } });
+    t.fill_rect(0, 0, 8, 1, 0);
+    REQUIRE(t.row(0) == rle_vector<int>{ { 0, 8 } });
+    t.set(0, 0, 1);
+    t.set(7, 0, 1);
+    REQUIRE(t.row(0) == rle_vector<int>{ { 1, 1 }, { 0, 6 }, { 1, 1 } });
+}
+
+TEST_CASE("rle_table can fill with one of its own elements")
+{
+    rle_table<int> t(4, 3, 0);
+    t.set(1, 0, 5);
+    t.fill_rect(0, 0, 4, 3, t(1, 0));
+    REQUIRE(t == rle_table<int>(4, 3, 5));
+}
+
+TEST_CASE("rle_table converts to and from a dense table")
+{
+    table<std::uint8_t> dense(37, 11, 0);
+    for (std::size_t y = 0; y < dense.height(); ++y)
+        for (std::size_t x = y; x < dense.width(); x += 5)
+            dense(x, y) = static_cast<std::uint8_t>(x % 3);
+
+    rle_table<std::uint8_t> compressed(dense);
+    REQUIRE(compressed(5, 0) == dense(5, 0));
+    REQUIRE(tables_equal(compressed.to_table(), dense));
+
+    compressed.fill_rect(3, 2, 20, 5, 9);
+    for (std::size_t y = 2; y < 7; ++y)
+        for (std::size_t x = 3; x < 23; ++x)
+            dense(x, y) = 9;
+    REQUIRE(tables_equal(compressed.to_table(), dense));
+}
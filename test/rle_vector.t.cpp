@@ -1,5 +1,7 @@
 #include <catch2/catch.hpp>
+#include <replay/byte_rgba.hpp>
 #include <replay/rle_vector.hpp>
+#include <string>
 
 using namespace replay;
 
@@ -93,3 +95,124 @@ TEST_CASE("can use suffix increment")
     REQUIRE(*i++ == 0xffaaffaaffaaffaaUL);
     REQUIRE(*i == 0x2277227722772277UL);
 }
+
+TEST_CASE("can access elements by position")
+{
+    rle_vector<int> v{ { 1, 3 }, { 2, 1 }, { 3, 4 } };
+    v.push(4, 2);
+    std::vector<int> const expected{ 1, 1, 1, 2, 3, 3, 3, 3, 4, 4 };
+    for (std::size_t i = 0; i < expected.size(); ++i)
+        REQUIRE(v[i] == expected[i]);
+    REQUIRE(v.at(9) == 4);
+    REQUIRE_THROWS_AS(v.at(10), std::out_of_range);
+}
+
+TEST_CASE("lower_bound finds the run containing a position")
+{
+    rle_vector<float> v{ { 56.7f, 6 }, { 123.4f, 7 }, { 8.9f, 2 } };
+    auto i = v.lower_bound(8);
+    REQUIRE(*i == 123.4f);
+    REQUIRE(i.repetition_count() == 5);
+    REQUIRE(v.lower_bound(15) == v.end());
+}
+
+TEST_CASE("iterator supports random access arithmetic")
+{
+    rle_vector<int> v{ { 1, 3 }, { 2, 1 }, { 3, 4 } };
+    auto i = v.end() - 5;
+    REQUIRE(*i == 2);
+    REQUIRE(i - v.begin() == 3);
+    REQUIRE(v.end() - v.begin() == 8);
+    REQUIRE(*--i == 1);
+    REQUIRE(i[4] == 3);
+    REQUIRE(v.begin() < i);
+    REQUIRE(*(2 + v.begin()) == 1);
+    i -= 2;
+    REQUIRE(i == v.begin());
+}
+
+TEST_CASE("iterator works with random access algorithms")
+{
+    rle_vector<int> v{ { 1, 3 }, { 5, 2 }, { 9, 4 } };
+    REQUIRE(std::distance(v.begin(), v.end()) == 9);
+    auto found = std::lower_bound(v.begin(), v.end(), 5);
+    REQUIRE(found - v.begin() == 3);
+    REQUIRE(std::upper_bound(v.begin(), v.end(), 5) - v.begin() == 5);
+}
+
+namespace
+{
+template <class T, class Generator> std::vector<T> make_runs(std::size_t count, Generator generate)
+{
+    std::vector<T> result;
+    std::uint32_t state = 12345;
+    while (result.size() < count)
+    {
+        state = state * 1664525u + 1013904223u;
+        auto const length = std::min<std::size_t>(1 + (state >> 16) % 40, count - result.size());
+        result.insert(result.end(), length, generate(state >> 8));
+    }
+    return result;
+}
+
+template <class T> void require_round_trip(std::vector<T> const& values)
+{
+    auto const encoded = rle_vector<T>::encode(values.data(), values.size());
+    REQUIRE(encoded.size() == values.size());
+
+    rle_vector<T> pushed;
+    for (auto const& each : values)
+    {
+        if (!pushed.empty() && each == *(pushed.end() - 1))
+            pushed.append(&each, 1);
+        else
+            pushed.push(each);
+    }
+    REQUIRE(encoded == pushed);
+
+    std::vector<T> expanded(values.size());
+    encoded.expand_into(expanded.data(), expanded.size());
+    REQUIRE(expanded == values);
+}
+} // namespace
+
+TEST_CASE("can bulk encode bytes")
+{
+    require_round_trip(make_runs<std::uint8_t>(5000, [](std::uint32_t x) { return std::uint8_t(x % 3); }));
+}
+
+TEST_CASE("can bulk encode 32-bit values")
+{
+    require_round_trip(make_runs<std::uint32_t>(5000, [](std::uint32_t x) { return x % 3; }));
+    require_round_trip(make_runs<byte_rgba>(5000, [](std::uint32_t x) { return byte_rgba(x % 3 << 8); }));
+}
+
+TEST_CASE("can bulk encode values that are not bitwise comparable")
+{
+    require_round_trip(make_runs<float>(500, [](std::uint32_t x) { return float(x % 3); }));
+    require_round_trip(make_runs<std::string>(500, [](std::uint32_t x) { return std::to_string(x % 3); }));
+}
+
+TEST_CASE("bulk encoding finds runs longer than a SIMD register")
+{
+    std::vector<std::uint8_t> values(100, 7);
+    values[63] = 8;
+    auto const encoded = rle_vector<std::uint8_t>::encode(values.data(), values.size());
+    REQUIRE(encoded == rle_vector<std::uint8_t>{ { 7, 63 }, { 8, 1 }, { 7, 36 } });
+}
+
+TEST_CASE("append extends the last run")
+{
+    rle_vector<int> v{ { 1, 2 } };
+    int const values[] = { 1, 1, 2 };
+    v.append(values, 3);
+    REQUIRE(v == rle_vector<int>{ { 1, 4 }, { 2, 1 } });
+    REQUIRE(v[3] == 1);
+}
+
+TEST_CASE("expand_into rejects too small outputs")
+{
+    rle_vector<int> v(4, 1);
+    int output[3];
+    REQUIRE_THROWS_AS(v.expand_into(output, 3), std::invalid_argument);
+}
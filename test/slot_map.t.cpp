@@ -0,0 +1,108 @@
+#include <catch2/catch.hpp>
+#include <replay/slot_map.hpp>
+#include <stdexcept>
+#include <string>
+
+using replay::slot_map;
+
+TEST_CASE("slot_map can access an inserted element", "[slot_map]")
+{
+    slot_map<std::string> map;
+    auto h = map.insert("hello");
+    REQUIRE(map.contains(h));
+    REQUIRE(map.at(h) == "hello");
+    REQUIRE(map.size() == 1);
+}
+
+TEST_CASE("slot_map default handle is never valid", "[slot_map]")
+{
+    slot_map<int> map;
+    map.insert(1);
+    REQUIRE(!map.contains(slot_map<int>::handle{}));
+}
+
+TEST_CASE("slot_map detects stale handles", "[slot_map]")
+{
+    slot_map<int> map;
+    auto old_handle = map.insert(1);
+    REQUIRE(map.erase(old_handle));
+    REQUIRE(!map.erase(old_handle));
+
+    auto new_handle = map.insert(2);
+    REQUIRE(new_handle.index == old_handle.index);
+    REQUIRE(!map.contains(old_handle));
+    REQUIRE(map.find(old_handle) == nullptr);
+    REQUIRE_THROWS_AS(map.at(old_handle), std::out_of_range);
+    REQUIRE(*map.find(new_handle) == 2);
+}
+
+TEST_CASE("slot_map key space stays bounded under churn", "[slot_map]")
+{
+    slot_map<int> map;
+    std::vector<slot_map<int>::handle> live;
+    for (int i = 0; i < 16; ++i)
+        live.push_back(map.insert(i));
+
+    for (int round = 0; round < 1000; ++round)
+    {
+        auto& victim = live[round % live.size()];
+        map.erase(victim);
+        victim = map.insert(round);
+    }
+
+    REQUIRE(map.size() == 16);
+    REQUIRE(map.values().smallest_key_bound() == 16);
+}
+
+TEST_CASE("slot_map keeps its slots when constructing a value throws", "[slot_map]")
+{
+    struct fragile
+    {
+        explicit fragile(bool fail)
+        {
+            if (fail)
+                throw std::runtime_error("construction failed");
+        }
+    };
+
+    slot_map<fragile> map;
+    auto const first = map.insert(false);
+    REQUIRE_THROWS_AS(map.insert(true), std::runtime_error);
+    REQUIRE(map.size() == 1);
+
+    map.erase(first);
+    REQUIRE_THROWS_AS(map.insert(true), std::runtime_error);
+    auto const reused = map.insert(false);
+    REQUIRE(reused.index == first.index);
+
+    auto const fresh = map.insert(false);
+    REQUIRE(fresh.index == 1);
+}
+
+TEST_CASE("slot_map clear invalidates all handles", "[slot_map]")
+{
+    slot_map<int> map;
+    auto a = map.insert(1);
+    auto b = map.insert(2);
+    map.clear();
+    REQUIRE(map.empty());
+    REQUIRE(!map.contains(a));
+    REQUIRE(!map.contains(b));
+}
+
+TEST_CASE("slot_map can iterate and recover handles", "[slot_map]")
+{
+    slot_map<int> map;
+    map.insert(10);
+    auto h = map.insert(20);
+    map.insert(30);
+
+    int sum = 0;
+    for (auto i = map.begin(), ie = map.end(); i != ie; ++i)
+    {
+        sum += *i;
+        if (*i == 20)
+            REQUIRE(map.handle_of(i) == h);
+    }
+    REQUIRE(sum == 60);
+}
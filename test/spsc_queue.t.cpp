@@ -0,0 +1,85 @@
+#include <catch2/catch.hpp>
+#include <replay/spsc_queue.hpp>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using replay::spsc_queue;
+
+TEST_CASE("spsc_queue rounds capacity up to a power of two", "[spsc_queue]")
+{
+    spsc_queue<int> queue(5);
+    REQUIRE(queue.capacity() == 8);
+}
+
+TEST_CASE("spsc_queue rejects capacities without a power of two to round up to", "[spsc_queue]")
+{
+    REQUIRE_THROWS_AS(spsc_queue<int>(0), std::invalid_argument);
+    REQUIRE_THROWS_AS(spsc_queue<int>(std::numeric_limits<std::size_t>::max()), std::length_error);
+}
+
+TEST_CASE("spsc_queue starts out empty", "[spsc_queue]")
+{
+    spsc_queue<int> queue(4);
+    REQUIRE(queue.empty());
+    REQUIRE(!queue.try_pop());
+}
+
+TEST_CASE("spsc_queue pops in fifo order", "[spsc_queue]")
+{
+    spsc_queue<std::string> queue(4);
+    queue.push("first");
+    queue.push("second");
+    REQUIRE(queue.size() == 2);
+    REQUIRE(queue.pop() == "first");
+    REQUIRE(*queue.try_pop() == "second");
+    REQUIRE(queue.empty());
+}
+
+TEST_CASE("spsc_queue try_push fails when full", "[spsc_queue]")
+{
+    spsc_queue<int> queue(2);
+    REQUIRE(queue.try_push(1));
+    REQUIRE(queue.try_push(2));
+    REQUIRE(!queue.try_push(3));
+    queue.pop();
+    REQUIRE(queue.try_push(3));
+}
+
+TEST_CASE("spsc_queue destructs remaining elements", "[spsc_queue]")
+{
+    auto shared = std::make_shared<int>(42);
+    {
+        spsc_queue<std::shared_ptr<int>> queue(4);
+        queue.push(shared);
+        queue.push(shared);
+        REQUIRE(shared.use_count() == 3);
+    }
+    REQUIRE(shared.use_count() == 1);
+}
+
+TEST_CASE("spsc_queue transfers values between threads in order", "[spsc_queue]")
+{
+    std::size_t const count = 100000;
+    spsc_queue<std::size_t> queue(64);
+
+    std::thread producer([&] {
+        for (std::size_t i = 0; i < count; ++i)
+            queue.push(i);
+    });
+
+    std::vector<std::size_t> received;
+    received.reserve(count);
+    for (std::size_t i = 0; i < count; ++i)
+        received.push_back(queue.pop());
+
+    producer.join();
+
+    bool in_order = true;
+    for (std::size_t i = 0; i < count; ++i)
+        in_order = in_order && received[i] == i;
+    REQUIRE(in_order);
+}
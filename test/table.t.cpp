@@ -1,5 +1,11 @@
 #include <catch2/catch.hpp>
 #include <replay/table.hpp>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+#include <vector>
 
 using namespace replay;
 
@@ -41,3 +47,250 @@ TEST_CASE("copy-assigned table has different address")
     REQUIRE(!other.empty());
     REQUIRE(other.ptr() != source.ptr());
 }
+
+namespace
+{
+template <class Layout> void require_layout_consistent(std::size_t w, std::size_t h)
+{
+    table<int, Layout> t(w, h, -1);
+    for (std::size_t y = 0; y < h; ++y)
+        for (std::size_t x = 0; x < w; ++x)
+            t(x, y) = static_cast<int>(y * w + x);
+
+    // Every element has its own storage inside the buffer
+    std::vector<bool> used(t.layout().size(), false);
+    bool unique = true;
+    for (std::size_t y = 0; y < h; ++y)
+        for (std::size_t x = 0; x < w; ++x)
+        {
+            auto const offset = t.element_offset(x, y);
+            unique = unique && offset < used.size() && !used[offset];
+            used[offset] = true;
+        }
+    REQUIRE(unique);
+
+    // Memory order visits each element once, at increasing addresses
+    std::size_t visited = 0;
+    int const* previous = nullptr;
+    bool ordered = true;
+    t.for_each([&](std::size_t x, std::size_t y, int const& value) {
+        ordered = ordered && value == static_cast<int>(y * w + x) && (previous == nullptr || previous < &value);
+        previous = &value;
+        ++visited;
+    });
+    REQUIRE(ordered);
+    REQUIRE(visited == w * h);
+
+    // Row iteration goes from left to right
+    for (std::size_t y = 0; y < h; ++y)
+    {
+        std::size_t expected_x = 0;
+        bool in_order = true;
+        t.for_each_in_row(y, [&](std::size_t x, int& value) {
+            in_order = in_order && x == expected_x++ && value == static_cast<int>(y * w + x);
+        });
+        REQUIRE(in_order);
+        REQUIRE(expected_x == w);
+    }
+
+    // Iterators visit each element once, row by row, without padding
+    std::vector<int> expected(w * h);
+    std::iota(expected.begin(), expected.end(), 0);
+    REQUIRE(std::vector<int>(t.begin(), t.end()) == expected);
+    auto const& const_table = t;
+    REQUIRE(std::vector<int>(const_table.begin(), const_table.end()) == expected);
+    auto const last_row = t.row(h - 1);
+    REQUIRE(std::vector<int>(last_row.begin(), last_row.end()) ==
+            std::vector<int>(expected.end() - static_cast<std::ptrdiff_t>(w), expected.end()));
+
+    auto const copy = t;
+    REQUIRE(copy(w - 1, h - 1) == static_cast<int>(w * h - 1));
+}
+} // namespace
+
+TEST_CASE("row-major layout addresses every element")
+{
+    require_layout_consistent<row_major_layout>(13, 7);
+}
+
+TEST_CASE("tiled layout addresses every element")
+{
+    require_layout_consistent<tiled_layout<8>>(13, 7);
+    require_layout_consistent<tiled_layout<4>>(16, 16);
+}
+
+TEST_CASE("morton layout addresses every element")
+{
+    require_layout_consistent<morton_layout>(13, 7);
+    require_layout_consistent<morton_layout>(5, 19);
+    require_layout_consistent<morton_layout>(32, 32);
+}
+
+TEST_CASE("tiled layout keeps tiles contiguous")
+{
+    table<int, tiled_layout<8>> t(32, 32);
+    REQUIRE(t.element_offset(7, 7) == 63);
+    REQUIRE(t.element_offset(8, 0) == 64);
+    REQUIRE(t.element_offset(0, 8) == 4 * 64);
+}
+
+TEST_CASE("morton layout interleaves coordinates")
+{
+    table<int, morton_layout> t(4, 4);
+    REQUIRE(t.element_offset(1, 0) == 1);
+    REQUIRE(t.element_offset(0, 1) == 2);
+    REQUIRE(t.element_offset(1, 1) == 3);
+    REQUIRE(t.element_offset(2, 0) == 4);
+    REQUIRE(t.element_offset(3, 3) == 15);
+}
+
+TEST_CASE("padded row layout iterators skip the padding")
+{
+    require_layout_consistent<aligned_row_layout<int>>(13, 7);
+}
+
+TEST_CASE("iterators of padded layouts only visit elements")
+{
+    table<int, tiled_layout<8>> tiled(3, 3, 1);
+    REQUIRE(std::accumulate(tiled.begin(), tiled.end(), 0) == 9);
+
+    table<int, morton_layout> morton(3, 5, 1);
+    REQUIRE(std::accumulate(morton.begin(), morton.end(), 0) == 15);
+
+    table<float, aligned_row_layout<float>> padded(5, 2);
+    padded.fill(2.f);
+    REQUIRE(std::accumulate(padded.begin(), padded.end(), 0.f) == 20.f);
+}
+
+TEST_CASE("tile ranges visit a clipped tile row by row")
+{
+    table<int, tiled_layout<4>> t(6, 5);
+    for (std::size_t y = 0; y < 5; ++y)
+        for (std::size_t x = 0; x < 6; ++x)
+            t(x, y) = static_cast<int>(y * 10 + x);
+
+    auto const inner = t.tile(0, 0);
+    REQUIRE(std::distance(inner.begin(), inner.end()) == 16);
+
+    auto const corner = t.tile(1, 1);
+    REQUIRE(std::vector<int>(corner.begin(), corner.end()) == std::vector<int>{ 44, 45 });
+
+    auto const region = std::as_const(t).region(1, 2, 2, 2);
+    REQUIRE(std::vector<int>(region.begin(), region.end()) == std::vector<int>{ 21, 22, 31, 32 });
+}
+
+TEST_CASE("tables with different layouts can be swapped and moved")
+{
+    table<int, tiled_layout<4>> a(5, 5, 1);
+    table<int, tiled_layout<4>> b(9, 3, 2);
+    a.swap(b);
+    REQUIRE(a.width() == 9);
+    REQUIRE(a(8, 2) == 2);
+    REQUIRE(b(4, 4) == 1);
+
+    auto c = std::move(a);
+    REQUIRE(a.empty());
+    REQUIRE(c(8, 2) == 2);
+}
+
+TEST_CASE("resize_preserving keeps the overlapping elements")
+{
+    table<int> t(4, 3);
+    for (std::size_t y = 0; y < 3; ++y)
+        for (std::size_t x = 0; x < 4; ++x)
+            t(x, y) = static_cast<int>(y * 4 + x);
+
+    t.resize_preserving(6, 2);
+    REQUIRE(t.width() == 6);
+    REQUIRE(t.height() == 2);
+    REQUIRE(t(3, 1) == 7);
+    REQUIRE(t(0, 1) == 4);
+
+    t.resize_preserving(2, 5);
+    REQUIRE(t(1, 1) == 5);
+    REQUIRE(t(0, 0) == 0);
+}
+
+TEST_CASE("resize_preserving moves elements")
+{
+    table<std::unique_ptr<int>> t(2, 2);
+    t(1, 1) = std::make_unique<int>(42);
+    auto const address = t(1, 1).get();
+    t.resize_preserving(3, 3);
+    REQUIRE(t(1, 1).get() == address);
+    REQUIRE(t(2, 2) == nullptr);
+}
+
+namespace
+{
+struct counted
+{
+    static int default_constructed;
+    static bool throw_on_default;
+
+    counted()
+    {
+        if (throw_on_default && default_constructed > 0)
+            throw std::runtime_error("out of values");
+        ++default_constructed;
+    }
+
+    counted(counted&& rhs) noexcept
+    : value(rhs.value)
+    {
+    }
+
+    int value = 0;
+};
+
+int counted::default_constructed = 0;
+bool counted::throw_on_default = false;
+} // namespace
+
+TEST_CASE("resize_preserving only default-constructs new elements")
+{
+    table<counted> t(3, 3);
+    t(2, 2).value = 7;
+    counted::default_constructed = 0;
+    t.resize_preserving(4, 3);
+    REQUIRE(counted::default_constructed == 3);
+    REQUIRE(t(2, 2).value == 7);
+}
+
+TEST_CASE("resize_preserving keeps the old size when construction throws")
+{
+    table<counted, tiled_layout<4>> t(3, 3);
+    t(1, 1).value = 5;
+    counted::default_constructed = 0;
+    counted::throw_on_default = true;
+    REQUIRE_THROWS_AS(t.resize_preserving(9, 9), std::runtime_error);
+    counted::throw_on_default = false;
+    REQUIRE(t.width() == 3);
+    REQUIRE(t(1, 1).value == 5);
+}
+
+TEST_CASE("aligned row layout starts every row on a cache line")
+{
+    table<float, aligned_row_layout<float>> t(13, 5, 1.f);
+    REQUIRE(t.layout().row_stride() == 16);
+    bool aligned = true;
+    for (std::size_t y = 0; y < t.height(); ++y)
+        aligned = aligned && reinterpret_cast<std::uintptr_t>(&t(0, y)) % 64 == 0;
+    REQUIRE(aligned);
+
+    t(12, 4) = 3.f;
+    auto const copy = t;
+    REQUIRE(copy(12, 4) == 3.f);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(copy.ptr()) % 64 == 0);
+}
+
+TEST_CASE("aligned row layout handles element sizes that do not divide the alignment")
+{
+    struct triple
+    {
+        char value[3];
+    };
+    table<triple, aligned_row_layout<triple>> t(5, 3);
+    REQUIRE(t.layout().row_stride() == 64);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(&t(0, 2)) % 64 == 0);
+}
@@ -0,0 +1,136 @@
+#include <catch2/catch.hpp>
+#include <replay/table_algorithms.hpp>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+using namespace replay;
+
+namespace
+{
+table<int> make_ramp(std::size_t w, std::size_t h)
+{
+    table<int> result(w, h);
+    for (std::size_t y = 0; y < h; ++y)
+        for (std::size_t x = 0; x < w; ++x)
+            result(x, y) = static_cast<int>(y * w + x);
+    return result;
+}
+} // namespace
+
+TEST_CASE("table transform applies a function to every element", "[table_algorithms]")
+{
+    thread_pool pool(3);
+    auto const source = make_ramp(37, 53);
+    table<float> destination(37, 53);
+    transform(pool, source, destination, [](int x) { return x * 0.5f; });
+
+    bool all = true;
+    for (std::size_t y = 0; y < 53; ++y)
+        for (std::size_t x = 0; x < 37; ++x)
+            all = all && destination(x, y) == source(x, y) * 0.5f;
+    REQUIRE(all);
+}
+
+TEST_CASE("table transform rejects tables of different size", "[table_algorithms]")
+{
+    table<int> source(4, 4, 0);
+    table<int> destination(4, 5, 0);
+    REQUIRE_THROWS_AS(transform(source, destination, [](int x) { return x; }), std::invalid_argument);
+}
+
+TEST_CASE("table zip_transform combines two tables", "[table_algorithms]")
+{
+    thread_pool pool(2);
+    auto const lhs = make_ramp(20, 30);
+    table<int> rhs(20, 30, 5);
+    table<int> destination(20, 30);
+    zip_transform(pool, lhs, rhs, destination, [](int a, int b) { return a * b; });
+    REQUIRE(destination(3, 7) == (7 * 20 + 3) * 5);
+    REQUIRE(destination(19, 29) == 599 * 5);
+}
+
+TEST_CASE("table reduce folds all elements", "[table_algorithms]")
+{
+    thread_pool pool(4);
+    auto const source = make_ramp(100, 100);
+    auto const sum = reduce(pool, source, std::int64_t(0), [](std::int64_t a, std::int64_t b) { return a + b; });
+    REQUIRE(sum == 9999 * 10000 / 2);
+    REQUIRE(reduce(source, 0, [](int a, int b) { return std::max(a, b); }) == 9999);
+}
+
+namespace range_algorithms
+{
+// Generic algorithms with the same signatures as the table algorithms, which argument dependent lookup finds as well
+template <class Range, class Value, class Function> Value reduce(Range const& range, Value value, Function function)
+{
+    for (auto const& each : range)
+        value = function(value, each);
+    return value;
+}
+
+template <class Range, class Destination, class Function>
+void transform(Range const& range, Destination&& destination, Function function)
+{
+    for (auto const& each : range)
+        destination.push_back(function(each));
+}
+} // namespace range_algorithms
+
+TEST_CASE("table algorithms do not compete with other algorithms of the same name", "[table_algorithms]")
+{
+    using range_algorithms::reduce;
+    using range_algorithms::transform;
+
+    // The element type makes replay an associated namespace of these calls
+    std::vector<table<int>> const tables{ table<int>(1, 1, 3), table<int>(2, 2, 4) };
+    REQUIRE(reduce(tables, std::size_t(0), [](std::size_t sum, table<int> const& x) { return sum + x.width(); }) == 3);
+
+    std::vector<int> heights;
+    transform(tables, heights, [](table<int> const& x) { return static_cast<int>(x.height()); });
+    REQUIRE(heights == std::vector<int>{ 1, 2 });
+
+    std::vector<int> const values{ 1, 2, 3 };
+    REQUIRE(reduce(values.begin(), values.end(), 0) == 6);
+}
+
+TEST_CASE("3x3 stencil clamps at the borders", "[table_algorithms]")
+{
+    thread_pool pool(2);
+    auto const source = make_ramp(6, 5);
+    table<int> destination(6, 5);
+    stencil<1>(pool, source, destination, [](auto const& window) {
+        int sum = 0;
+        for (int dy = -1; dy <= 1; ++dy)
+            for (int dx = -1; dx <= 1; ++dx)
+                sum += window(dx, dy);
+        return sum;
+    });
+
+    // Reference with explicit clamping
+    bool all = true;
+    for (int y = 0; y < 5; ++y)
+        for (int x = 0; x < 6; ++x)
+        {
+            int expected = 0;
+            for (int dy = -1; dy <= 1; ++dy)
+                for (int dx = -1; dx <= 1; ++dx)
+                    expected += source(std::min(std::max(x + dx, 0), 5), std::min(std::max(y + dy, 0), 4));
+            all = all && destination(x, y) == expected;
+        }
+    REQUIRE(all);
+}
+
+TEST_CASE("5x5 stencil works on tables smaller than the stencil", "[table_algorithms]")
+{
+    table<int> source(3, 2, 1);
+    table<int> destination(3, 2, 0);
+    stencil<2>(source, destination, [](auto const& window) {
+        int sum = 0;
+        for (int dy = -2; dy <= 2; ++dy)
+            for (int dx = -2; dx <= 2; ++dx)
+                sum += window(dx, dy);
+        return sum + window.center();
+    });
+    REQUIRE(std::all_of(destination.begin(), destination.end(), [](int x) { return x == 26; }));
+}
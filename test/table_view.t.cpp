@@ -0,0 +1,92 @@
+#include <catch2/catch.hpp>
+#include <replay/table_algorithms.hpp>
+#include <replay/table_view.hpp>
+#include <vector>
+
+using namespace replay;
+
+TEST_CASE("table_view of a table refers to its elements", "[table_view]")
+{
+    table<int> t(4, 3, 0);
+    table_view<int> view(t);
+    view(2, 1) = 7;
+    REQUIRE(t(2, 1) == 7);
+    REQUIRE(view.width() == 4);
+    REQUIRE(view.height() == 3);
+    REQUIRE(view.stride() == 4);
+}
+
+TEST_CASE("subview addresses a region of the table", "[table_view]")
+{
+    table<int> t(8, 6, 0);
+    auto region = table_view<int>(t).subview(2, 1, 3, 4);
+    region.fill(5);
+    REQUIRE(region.stride() == 8);
+    REQUIRE(t(1, 1) == 0);
+    REQUIRE(t(2, 1) == 5);
+    REQUIRE(t(4, 4) == 5);
+    REQUIRE(t(5, 4) == 0);
+    REQUIRE(t(4, 5) == 0);
+
+    auto nested = region.subview(1, 1, 2, 2);
+    REQUIRE(&nested(0, 0) == &t(3, 2));
+    REQUIRE_THROWS_AS(region.subview(2, 0, 2, 1), std::out_of_range);
+}
+
+TEST_CASE("subview can be created from a box", "[table_view]")
+{
+    table<int> t(8, 6, 0);
+    auto region = table_view<int>(t).subview(box<int>(1, 2, 4, 6));
+    REQUIRE(region.width() == 3);
+    REQUIRE(region.height() == 4);
+    REQUIRE(&region(0, 0) == &t(1, 2));
+}
+
+TEST_CASE("table_view can wrap a raw buffer with a stride", "[table_view]")
+{
+    std::vector<float> buffer(5 * 4, 0.f);
+    table_view<float> view(buffer.data(), 3, 4, 5);
+    view(2, 3) = 1.f;
+    REQUIRE(buffer[3 * 5 + 2] == 1.f);
+}
+
+TEST_CASE("const_table_view can be created from tables and mutable views", "[table_view]")
+{
+    table<int> const t(3, 3, 4);
+    const_table_view<int> from_table(t);
+    REQUIRE(from_table(1, 1) == 4);
+
+    table<int> u(3, 3, 2);
+    table_view<int> mutable_view(u);
+    const_table_view<int> from_view = mutable_view;
+    REQUIRE(from_view(2, 2) == 2);
+
+    table_view deduced(t);
+    static_assert(std::is_same<decltype(deduced), const_table_view<int>>::value, "Deduces a read-only view");
+}
+
+TEST_CASE("table algorithms work on sub-regions in place", "[table_view]")
+{
+    thread_pool pool(2);
+    table<int> t(10, 10, 1);
+    auto const region = table_view<int>(t).subview(2, 3, 4, 5);
+    transform(pool, const_table_view<int>(region), region, [](int x) { return x + 1; });
+    REQUIRE(reduce(pool, const_table_view<int>(t), 0, [](int a, int b) { return a + b; }) == 100 + 20);
+    REQUIRE(t(2, 3) == 2);
+    REQUIRE(t(6, 3) == 1);
+
+    table<int> source(4, 5, 3);
+    zip_transform(pool, source, region, table_view<int>(t).subview(6, 0, 4, 5), [](int a, int b) { return a * b; });
+    REQUIRE(t(6, 0) == 3 * 2);
+    REQUIRE(t(9, 4) == 3 * 2);
+    REQUIRE(t(5, 0) == 1);
+}
+
+TEST_CASE("table_view of an aligned table uses its row stride", "[table_view]")
+{
+    table<float, aligned_row_layout<float>> t(5, 4, 1.f);
+    table_view<float> view(t);
+    REQUIRE(view.stride() == 16);
+    transform(thread_pool::shared(), const_table_view<float>(view), view, [](float x) { return x * 2.f; });
+    REQUIRE(t(4, 3) == 2.f);
+}
@@ -0,0 +1,91 @@
+#include <catch2/catch.hpp>
+#include <replay/thread_pool.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+using replay::thread_pool;
+
+TEST_CASE("thread_pool runs submitted tasks", "[thread_pool]")
+{
+    thread_pool pool(2);
+    std::atomic<int> counter{ 0 };
+    for (int i = 0; i < 100; ++i)
+        pool.submit([&counter] { counter.fetch_add(1); });
+
+    while (counter.load() != 100)
+        pool.run_pending_task();
+
+    REQUIRE(counter.load() == 100);
+}
+
+TEST_CASE("parallel_for visits every index exactly once", "[thread_pool]")
+{
+    thread_pool pool(4);
+    std::vector<int> visits(10000, 0);
+    replay::parallel_for(pool, 0, visits.size(), 7, [&](std::size_t begin, std::size_t end) {
+        for (auto i = begin; i < end; ++i)
+            visits[i] += 1;
+    });
+
+    REQUIRE(std::all_of(visits.begin(), visits.end(), [](int x) { return x == 1; }));
+}
+
+TEST_CASE("parallel_for respects the grain size", "[thread_pool]")
+{
+    thread_pool pool(2);
+    std::atomic<std::size_t> largest{ 0 };
+    replay::parallel_for(pool, 3, 1000, 16, [&](std::size_t begin, std::size_t end) {
+        auto current = largest.load();
+        while (end - begin > current && !largest.compare_exchange_weak(current, end - begin))
+        {
+        }
+    });
+    REQUIRE(largest.load() == 16);
+}
+
+TEST_CASE("parallel_for can be nested", "[thread_pool]")
+{
+    thread_pool pool(3);
+    std::atomic<std::size_t> total{ 0 };
+    replay::parallel_for(pool, 0, 16, 1, [&](std::size_t, std::size_t) {
+        replay::parallel_for(pool, 0, 100, 10, [&](std::size_t begin, std::size_t end) { total += end - begin; });
+    });
+    REQUIRE(total.load() == 1600);
+}
+
+TEST_CASE("parallel_for rethrows exceptions", "[thread_pool]")
+{
+    thread_pool pool(2);
+    auto throwing = [](std::size_t begin, std::size_t) {
+        if (begin == 50)
+            throw std::runtime_error("failed");
+    };
+    REQUIRE_THROWS_AS(replay::parallel_for(pool, 0, 100, 10, throwing), std::runtime_error);
+}
+
+TEST_CASE("parallel_reduce sums a range", "[thread_pool]")
+{
+    thread_pool pool(4);
+    std::vector<std::uint64_t> values(100000);
+    std::iota(values.begin(), values.end(), std::uint64_t{ 1 });
+
+    auto sum = replay::parallel_reduce(
+        pool, 0, values.size(), 0, std::uint64_t{ 0 },
+        [&](std::size_t begin, std::size_t end) {
+            return std::accumulate(values.begin() + begin, values.begin() + end, std::uint64_t{ 0 });
+        },
+        [](std::uint64_t lhs, std::uint64_t rhs) { return lhs + rhs; });
+
+    REQUIRE(sum == 100000ull * 100001ull / 2);
+}
+
+TEST_CASE("parallel_reduce of an empty range is the identity", "[thread_pool]")
+{
+    auto result = replay::parallel_reduce(
+        5, 5, 1, 42, [](std::size_t, std::size_t) { return 0; }, [](int lhs, int rhs) { return lhs + rhs; });
+    REQUIRE(result == 42);
+}